@@ -0,0 +1,817 @@
+// Standalone benchmarks for the hsm.h state machine core, the hsm_static.h static state machine and the Jumper
+// traversal kernels.
+//
+// Each benchmark is run several times; the median time per operation and the number of heap allocations per
+// operation are written as JSON, to stdout or to the file passed with --out.
+//
+// Usage: HsmBenchmark [--out <file>] [--filter <substring>] [--iterations <count>]
+
+#include "hsm.h"
+#include "hsm_static.h"
+#include "JumperTraversalKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation counting
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// GCC can't see that the replaced operator new and delete below match
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static size_t gNumAllocations = 0;
+
+void* operator new(size_t size)
+{
+	++gNumAllocations;
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Harness
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	struct BenchmarkResult
+	{
+		std::string mName;
+		std::string mVariant;
+		int mDepth;
+		size_t mIterations;
+		double mNsPerOp;
+		double mAllocsPerOp;
+	};
+
+	struct BenchmarkConfig
+	{
+		BenchmarkConfig() : mOutFile(0), mFilter(0), mIterations(1000000) {}
+		const char* mOutFile;
+		const char* mFilter;
+		size_t mIterations;
+	};
+
+	const int kNumRuns = 5;
+	const int kDepths[] = { 1, 2, 4, 8, 16 };
+
+	BenchmarkConfig gConfig;
+	std::vector<BenchmarkResult> gResults;
+
+	// Written to by benchmarks so the compiler can't discard the work being measured
+	volatile size_t gSink = 0;
+
+	// Runs func(iterations) kNumRuns times after a warm-up run, and records the median time per iteration
+	template <typename Func>
+	void RunBenchmark(const char* name, const char* variant, int depth, Func&& func)
+	{
+		std::string fullName = std::string(name) + "/" + variant + "/" + std::to_string(depth);
+		if (gConfig.mFilter && fullName.find(gConfig.mFilter) == std::string::npos)
+			return;
+
+		const size_t iterations = gConfig.mIterations;
+		func(iterations / 10 + 1);
+
+		std::vector<double> nsPerOp;
+		size_t numAllocations = 0;
+		for (int run = 0; run < kNumRuns; ++run)
+		{
+			const size_t numAllocationsBefore = gNumAllocations;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			func(iterations);
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			numAllocations += gNumAllocations - numAllocationsBefore;
+
+			nsPerOp.push_back(std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+		}
+		std::sort(nsPerOp.begin(), nsPerOp.end());
+
+		BenchmarkResult result;
+		result.mName = name;
+		result.mVariant = variant;
+		result.mDepth = depth;
+		result.mIterations = iterations;
+		result.mNsPerOp = nsPerOp[kNumRuns / 2];
+		result.mAllocsPerOp = static_cast<double>(numAllocations) / (static_cast<double>(iterations) * kNumRuns);
+		gResults.push_back(result);
+
+		std::fprintf(stderr, "%-48s %10.2f ns/op %8.3f allocs/op\n", fullName.c_str(), result.mNsPerOp, result.mAllocsPerOp);
+	}
+
+	void WriteResults(FILE* file)
+	{
+		std::fprintf(file, "{\n  \"iterations\": %zu,\n  \"runs\": %d,\n  \"benchmarks\": [\n", gConfig.mIterations, kNumRuns);
+		for (size_t i = 0; i < gResults.size(); ++i)
+		{
+			const BenchmarkResult& result = gResults[i];
+			std::fprintf(file, "    { \"name\": \"%s\", \"variant\": \"%s\", \"depth\": %d, \"iterations\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.4f }%s\n",
+				result.mName.c_str(), result.mVariant.c_str(), result.mDepth, result.mIterations, result.mNsPerOp, result.mAllocsPerOp,
+				i + 1 < gResults.size() ? "," : "");
+		}
+		std::fprintf(file, "  ]\n}\n");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// States
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Stack shape: Level<0> ... Level<depth - 2> chained by InnerEntry transitions, with LeafA or LeafB innermost.
+// Flipping mFlip makes the innermost state change on the next ProcessStateTransitions, either by a sibling
+// transition of the leaf itself or by an inner transition of its outer state.
+
+using namespace hsm;
+
+namespace
+{
+	enum TransitionMode
+	{
+		SiblingMode,
+		InnerMode,
+		NoTransitionMode
+	};
+
+	struct BenchOwner
+	{
+		BenchOwner() : mDepth(1), mMode(SiblingMode), mFlip(false), mValueA(0), mValueB(0), mUpdateCount(0) {}
+		int mDepth;
+		TransitionMode mMode;
+		bool mFlip;
+		StateValue<int> mValueA;
+		StateValue<float> mValueB;
+		size_t mUpdateCount;
+	};
+
+	const int kMaxDepth = 16;
+
+	struct BenchState : StateWithOwner<BenchOwner>
+	{
+		DEFINE_HSM_STATE(BenchState)
+
+		virtual void Update(int EventId) override
+		{
+			Owner().mUpdateCount += static_cast<size_t>(EventId);
+		}
+	};
+
+	struct LeafA;
+	struct LeafB;
+
+	template <bool IsB>
+	struct Leaf : BenchState
+	{
+		virtual Transition GetTransition() override
+		{
+			if (Owner().mMode == SiblingMode && Owner().mFlip != IsB)
+			{
+				return IsB ? SiblingTransition<LeafA>() : SiblingTransition<LeafB>();
+			}
+			return NoTransition();
+		}
+	};
+
+	struct LeafA : Leaf<false> { DEFINE_HSM_STATE(LeafA) };
+	struct LeafB : Leaf<true> { DEFINE_HSM_STATE(LeafB) };
+
+	template <int N>
+	struct Level : BenchState
+	{
+		DEFINE_HSM_STATE(Level)
+
+		typedef typename std::conditional<(N + 1 < kMaxDepth), Level<N + 1>, LeafA>::type NextLevel;
+
+		virtual Transition GetTransition() override
+		{
+			if (N + 2 < Owner().mDepth)
+			{
+				return InnerEntryTransition<NextLevel>();
+			}
+
+			// We are the leaf's outer state
+			if (Owner().mMode == InnerMode)
+			{
+				return Owner().mFlip ? InnerTransition<LeafB>() : InnerTransition<LeafA>();
+			}
+			return InnerEntryTransition<LeafA>();
+		}
+	};
+
+	// Sets two StateValues on enter, which are reset when the state is exited
+	struct ValueStateA;
+	struct ValueStateB;
+
+	template <bool IsB>
+	struct ValueState : BenchState
+	{
+		virtual void OnEnter() override
+		{
+			SetStateValue(Owner().mValueA) = IsB ? 2 : 1;
+			SetStateValue(Owner().mValueB) = IsB ? 2.0f : 1.0f;
+		}
+
+		virtual Transition GetTransition() override
+		{
+			if (Owner().mFlip != IsB)
+			{
+				return IsB ? SiblingTransition<ValueStateA>() : SiblingTransition<ValueStateB>();
+			}
+			return NoTransition();
+		}
+	};
+
+	struct ValueStateA : ValueState<false> { DEFINE_HSM_STATE(ValueStateA) };
+	struct ValueStateB : ValueState<true> { DEFINE_HSM_STATE(ValueStateB) };
+
+	// Target of transitions with args
+	struct ArgsState : BenchState
+	{
+		DEFINE_HSM_STATE(ArgsState)
+		void OnEnter(int value, float scale) { Owner().mUpdateCount += static_cast<size_t>(value * scale); }
+	};
+
+	// States this large don't fit the state stack's inline slots, so they are allocated unless pooled
+	struct OversizedStateA;
+	struct OversizedStateB;
+
+	template <bool IsB>
+	struct OversizedState : BenchState
+	{
+		virtual Transition GetTransition() override
+		{
+			if (Owner().mFlip != IsB)
+			{
+				return IsB ? SiblingTransition<OversizedStateA>() : SiblingTransition<OversizedStateB>();
+			}
+			return NoTransition();
+		}
+
+		char mPayload[HSM_STATE_SLOT_SIZE];
+	};
+
+	struct OversizedStateA : OversizedState<false> { DEFINE_HSM_STATE(OversizedStateA) };
+	struct OversizedStateB : OversizedState<true> { DEFINE_HSM_STATE(OversizedStateB) };
+
+	void StartMachine(StateMachine& stateMachine, BenchOwner& owner, int depth, TransitionMode mode)
+	{
+		owner.mDepth = depth;
+		owner.mMode = mode;
+		owner.mFlip = false;
+
+		if (depth == 1)
+		{
+			stateMachine.Initialize<LeafA>(&owner);
+		}
+		else
+		{
+			stateMachine.Initialize<Level<0> >(&owner);
+		}
+		stateMachine.ProcessStateTransitions();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	// One transition of the innermost state per ProcessStateTransitions
+	void BenchmarkTransitions(const char* name, TransitionMode mode, int minDepth)
+	{
+		for (int depth : kDepths)
+		{
+			if (depth < minDepth)
+				continue;
+
+			BenchOwner owner;
+			StateMachine stateMachine;
+			StartMachine(stateMachine, owner, depth, mode);
+
+			RunBenchmark(name, "default", depth, [&](size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					owner.mFlip = !owner.mFlip;
+					stateMachine.ProcessStateTransitions();
+				}
+			});
+		}
+	}
+
+	// Sibling transitions between states too large for the inline slots, allocated each time or taken from the pool
+	void BenchmarkOversizedTransitions()
+	{
+		for (int pooled = 0; pooled < 2; ++pooled)
+		{
+			BenchOwner owner;
+			StateMachine stateMachine;
+			stateMachine.SetStatePoolingEnabled(pooled != 0);
+			stateMachine.Initialize<OversizedStateA>(&owner);
+			stateMachine.ProcessStateTransitions();
+
+			RunBenchmark("oversized_transition", pooled ? "pooled" : "heap", 1, [&](size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					owner.mFlip = !owner.mFlip;
+					stateMachine.ProcessStateTransitions();
+				}
+			});
+		}
+	}
+
+	// Settled stack: by default every state is asked for its transition, none is taken. With dirty transitions,
+	// no state marked itself dirty, so no state is asked.
+	void BenchmarkNoTransitions()
+	{
+		for (int depth : kDepths)
+		{
+			for (int dirty = 0; dirty < 2; ++dirty)
+			{
+				BenchOwner owner;
+				StateMachine stateMachine;
+				stateMachine.SetDirtyTransitionsEnabled(dirty != 0);
+				StartMachine(stateMachine, owner, depth, NoTransitionMode);
+
+				RunBenchmark("process_no_transition", dirty ? "dirty" : "default", depth, [&](size_t iterations)
+				{
+					for (size_t i = 0; i < iterations; ++i)
+					{
+						stateMachine.ProcessStateTransitions();
+					}
+				});
+			}
+		}
+	}
+
+	// A frame's worth of input on a settled stack: three queued events dispatched, none causing a transition
+	void BenchmarkDispatchQueuedEvents()
+	{
+		for (int depth : kDepths)
+		{
+			for (int dirty = 0; dirty < 2; ++dirty)
+			{
+				BenchOwner owner;
+				StateMachine stateMachine;
+				stateMachine.SetDirtyTransitionsEnabled(dirty != 0);
+				StartMachine(stateMachine, owner, depth, NoTransitionMode);
+
+				RunBenchmark("dispatch_queued_events", dirty ? "dirty" : "default", depth, [&](size_t iterations)
+				{
+					for (size_t i = 0; i < iterations; ++i)
+					{
+						stateMachine.QueueEvent(0);
+						stateMachine.QueueEvent(1);
+						stateMachine.QueueEvent(2);
+						stateMachine.DispatchQueuedEvents();
+					}
+					gSink = owner.mUpdateCount;
+				});
+			}
+		}
+	}
+
+	// Pops the whole stack and pushes it back via InnerEntry transitions at every depth
+	void BenchmarkInnerEntryRebuild()
+	{
+		for (int depth : kDepths)
+		{
+			BenchOwner owner;
+			StateMachine stateMachine;
+			StartMachine(stateMachine, owner, depth, NoTransitionMode);
+
+			RunBenchmark("inner_entry_rebuild", "default", depth, [&](size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					stateMachine.Stop();
+					stateMachine.ProcessStateTransitions();
+				}
+			});
+		}
+	}
+
+	void BenchmarkUpdateStates()
+	{
+		for (int depth : kDepths)
+		{
+			BenchOwner owner;
+			StateMachine stateMachine;
+			StartMachine(stateMachine, owner, depth, NoTransitionMode);
+
+			RunBenchmark("update_states", "default", depth, [&](size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					stateMachine.UpdateStates(1);
+				}
+				gSink = owner.mUpdateCount;
+			});
+		}
+	}
+
+	void BenchmarkLookups()
+	{
+		for (int depth : kDepths)
+		{
+			BenchOwner owner;
+			StateMachine stateMachine;
+			StartMachine(stateMachine, owner, depth, NoTransitionMode);
+
+			// The innermost state is the worst case for searches from the outermost state
+			RunBenchmark("get_state_innermost", "default", depth, [&](size_t iterations)
+			{
+				size_t found = 0;
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					found += stateMachine.GetState<LeafA>() != 0;
+				}
+				gSink = found;
+			});
+
+			RunBenchmark("is_in_state_missing", "default", depth, [&](size_t iterations)
+			{
+				size_t found = 0;
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					found += stateMachine.IsInState<LeafB>();
+				}
+				gSink = found;
+			});
+		}
+	}
+
+	// Enter/exit cycle of a state that sets two StateValues on enter
+	void BenchmarkStateValues()
+	{
+		BenchOwner owner;
+		StateMachine stateMachine;
+		stateMachine.Initialize<ValueStateA>(&owner);
+		stateMachine.ProcessStateTransitions();
+
+		RunBenchmark("state_value_enter_exit", "default", 1, [&](size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				owner.mFlip = !owner.mFlip;
+				stateMachine.ProcessStateTransitions();
+			}
+			gSink = static_cast<size_t>(owner.mValueA.Value());
+		});
+	}
+
+	// Transition objects as returned by GetTransition and copied into a state's mTransition member
+	struct StdFunctionTransition
+	{
+		StdFunctionTransition() : mTransitionType(Transition::No), mStateFactory(0) {}
+		Transition::Type mTransitionType;
+		const StateFactory* mStateFactory;
+		std::function<void (State*)> mOnEnterArgsFunc;
+	};
+
+	void BenchmarkTransitionObjects()
+	{
+		RunBenchmark("transition_copy", "no_args", 0, [&](size_t iterations)
+		{
+			Transition stored;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				stored = SiblingTransition<LeafA>();
+			}
+			gSink = stored.IsSibling();
+		});
+
+		RunBenchmark("transition_copy", "args", 0, [&](size_t iterations)
+		{
+			Transition stored;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				stored = SiblingTransition<ArgsState>(static_cast<int>(i), 2.0f);
+			}
+			gSink = stored.IsSibling();
+		});
+
+		// Baseline: the std::function based OnEnter args thunk that Transition used to carry
+		RunBenchmark("transition_copy", "args_std_function", 0, [&](size_t iterations)
+		{
+			StdFunctionTransition stored;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				const int value = static_cast<int>(i);
+				const float scale = 2.0f;
+				StdFunctionTransition transition;
+				transition.mTransitionType = Transition::Sibling;
+				transition.mStateFactory = &GetStateFactory<ArgsState>();
+				transition.mOnEnterArgsFunc = [value, scale](State* state) { static_cast<ArgsState*>(state)->OnEnter(value, scale); };
+				stored = transition;
+			}
+			gSink = stored.mTransitionType;
+		});
+
+		// Larger captures, such as a string arg, don't fit std::function's small buffer
+		RunBenchmark("transition_copy", "args_with_string_std_function", 0, [&](size_t iterations)
+		{
+			StdFunctionTransition stored;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				const int value = static_cast<int>(i);
+				const float scale = 2.0f;
+				const std::string tag = "arg";
+				StdFunctionTransition transition;
+				transition.mTransitionType = Transition::Sibling;
+				transition.mStateFactory = &GetStateFactory<ArgsState>();
+				transition.mOnEnterArgsFunc = [value, scale, tag](State* state) { static_cast<ArgsState*>(state)->OnEnter(value, scale); };
+				stored = transition;
+			}
+			gSink = stored.mTransitionType;
+		});
+
+		RunBenchmark("transition_copy", "args_with_string", 0, [&](size_t iterations)
+		{
+			Transition stored;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				const int value = static_cast<int>(i);
+				const float scale = 2.0f;
+				const std::string tag = "arg";
+				stored = Transition(Transition::Sibling, GetStateFactory<ArgsState>(),
+					OnEnterArgsFunc([value, scale, tag](State* state) { static_cast<ArgsState*>(state)->OnEnter(value, scale); }));
+			}
+			gSink = stored.IsSibling();
+		});
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Static state machine
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The same flat machine of kNumFlatStates sibling states, shaped like the Jumper states, as an hsm::StateMachine
+// and as an hsm::StaticStateMachine. Each Update counts the event; while mCycle is set, it also requests a sibling
+// transition to the next state, which the next ProcessStateTransitions makes.
+
+namespace
+{
+	const int kNumFlatStates = 5;
+
+	struct FlatOwner
+	{
+		FlatOwner() : mCycle(false), mTransitionRequested(false), mUpdateCount(0) {}
+		bool mCycle;
+		bool mTransitionRequested;
+		size_t mUpdateCount;
+	};
+
+	template <int N>
+	struct DynamicFlatState : StateWithOwner<FlatOwner>
+	{
+		DEFINE_HSM_STATE(DynamicFlatState)
+
+		virtual void OnEnter() override { Owner().mTransitionRequested = false; }
+
+		virtual void Update(int EventId) override
+		{
+			Owner().mUpdateCount += static_cast<size_t>(EventId);
+			Owner().mTransitionRequested = Owner().mCycle;
+		}
+
+		virtual Transition GetTransition() override
+		{
+			return Owner().mTransitionRequested ? SiblingTransition< DynamicFlatState<(N + 1) % kNumFlatStates> >() : NoTransition();
+		}
+	};
+
+	template <int N>
+	struct StaticFlatState;
+
+	typedef StaticStateList<StaticFlatState<0>, StaticFlatState<1>, StaticFlatState<2>, StaticFlatState<3>, StaticFlatState<4> > StaticFlatStates;
+
+	template <int N>
+	struct StaticFlatState : StaticState<FlatOwner, StaticFlatStates>
+	{
+		void OnEnter() { Owner().mTransitionRequested = false; }
+
+		void Update(int EventId)
+		{
+			Owner().mUpdateCount += static_cast<size_t>(EventId);
+			Owner().mTransitionRequested = Owner().mCycle;
+		}
+
+		Transition GetTransition()
+		{
+			return Owner().mTransitionRequested ? SiblingTransition< StaticFlatState<(N + 1) % kNumFlatStates> >() : NoTransition();
+		}
+	};
+
+	// One event per op: UpdateStates, then ProcessStateTransitions, as DispatchQueuedEvents does
+	template <typename StateMachineType>
+	void RunFlatMachine(const char* name, const char* variant, StateMachineType& stateMachine, FlatOwner& owner, bool cycle)
+	{
+		owner.mCycle = cycle;
+		stateMachine.ProcessStateTransitions();
+
+		RunBenchmark(name, variant, 1, [&](size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				stateMachine.UpdateStates(1);
+				stateMachine.ProcessStateTransitions();
+			}
+			gSink = owner.mUpdateCount;
+		});
+	}
+
+	void BenchmarkStaticStateMachine()
+	{
+		for (int cycle = 0; cycle < 2; ++cycle)
+		{
+			const char* name = cycle ? "flat_event_transition" : "flat_event_no_transition";
+			{
+				FlatOwner owner;
+				StateMachine stateMachine;
+				stateMachine.Initialize< DynamicFlatState<0> >(&owner);
+				RunFlatMachine(name, "dynamic", stateMachine, owner, cycle != 0);
+			}
+			{
+				FlatOwner owner;
+				StaticStateMachine<FlatOwner, StaticFlatStates> stateMachine;
+				stateMachine.Initialize< StaticFlatState<0> >(&owner);
+				RunFlatMachine(name, "static", stateMachine, owner, cycle != 0);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Traversal kernels
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	// Packed traversal data of a crowd, laid out like FJumperTraversalStore
+	struct TraversalCrowd
+	{
+		explicit TraversalCrowd(size_t num)
+			: mLocationX(num), mLocationY(num), mLocationZ(num), mVelocityZ(num)
+			, mWallImpactX(num), mWallImpactY(num), mWallImpactZ(num), mFlags(num)
+		{
+			// Deterministic mix of characters near and far from their wall, rising and falling, with all flag combinations
+			uint32_t seed = 12345;
+			auto random = [&seed](float range) { seed = seed * 1664525u + 1013904223u; return (static_cast<float>(seed >> 8) / 16777216.0f) * range; };
+			for (size_t i = 0; i < num; ++i)
+			{
+				mLocationX[i] = random(10000.0f);
+				mLocationY[i] = random(10000.0f);
+				mLocationZ[i] = random(1000.0f);
+				mWallImpactX[i] = mLocationX[i] + random(120.0f) - 60.0f;
+				mWallImpactY[i] = mLocationY[i] + random(120.0f) - 60.0f;
+				mWallImpactZ[i] = mLocationZ[i] + random(40.0f) - 20.0f;
+				mVelocityZ[i] = random(20.0f) - 10.0f;
+				mFlags[i] = static_cast<uint8_t>(static_cast<uint32_t>(random(16.0f)) & 0xF);
+			}
+		}
+
+		JumperTraversalKernels::FInput GetInput() const
+		{
+			JumperTraversalKernels::FInput input;
+			input.LocationX = mLocationX.data();
+			input.LocationY = mLocationY.data();
+			input.LocationZ = mLocationZ.data();
+			input.VelocityZ = mVelocityZ.data();
+			input.WallImpactX = mWallImpactX.data();
+			input.WallImpactY = mWallImpactY.data();
+			input.WallImpactZ = mWallImpactZ.data();
+			input.Flags = mFlags.data();
+			input.Num = static_cast<int32_t>(mFlags.size());
+			input.WallSlideDistanceSquared = 70.0f * 70.0f;
+			input.MaxWallSlideVelocityZ = 5.0f;
+			return input;
+		}
+
+		std::vector<float> mLocationX, mLocationY, mLocationZ, mVelocityZ;
+		std::vector<float> mWallImpactX, mWallImpactY, mWallImpactZ;
+		std::vector<uint8_t> mFlags;
+	};
+
+	typedef void (*TraversalKernel)(const JumperTraversalKernels::FInput&, uint8_t*, uint8_t);
+
+	void EvaluateScalar(const JumperTraversalKernels::FInput& input, uint8_t* outMasks, uint8_t extraBits)
+	{
+		JumperTraversalKernels::EvaluatePredicatesScalar(input, outMasks, extraBits);
+	}
+
+	// Time per character of evaluating the wall-slide and ledge-grab predicates over a crowd. The SIMD kernels
+	// must produce the same masks as the scalar one.
+	void BenchmarkTraversalPredicates()
+	{
+		const int kNumCharacters = 10000;
+		const TraversalCrowd crowd(kNumCharacters);
+		const JumperTraversalKernels::FInput input = crowd.GetInput();
+
+		std::vector<uint8_t> expectedMasks(kNumCharacters);
+		EvaluateScalar(input, expectedMasks.data(), 0x80);
+
+		struct Variant { const char* mName; TraversalKernel mKernel; };
+		std::vector<Variant> variants;
+		variants.push_back(Variant{ "scalar", &EvaluateScalar });
+#if JUMPER_TRAVERSAL_KERNELS_X64
+		variants.push_back(Variant{ "sse2", &JumperTraversalKernels::EvaluatePredicatesSSE2 });
+		if (JumperTraversalKernels::IsAVX2Supported())
+		{
+			variants.push_back(Variant{ "avx2", &JumperTraversalKernels::EvaluatePredicatesAVX2 });
+		}
+#endif
+
+		for (const Variant& variant : variants)
+		{
+			std::vector<uint8_t> masks(kNumCharacters);
+			variant.mKernel(input, masks.data(), 0x80);
+			if (masks != expectedMasks)
+			{
+				std::fprintf(stderr, "traversal_predicates/%s: masks differ from the scalar kernel\n", variant.mName);
+				std::exit(1);
+			}
+
+			RunBenchmark("traversal_predicates", variant.mName, kNumCharacters, [&](size_t iterations)
+			{
+				// iterations counts characters, rounded up to whole crowds
+				for (size_t evaluated = 0; evaluated < iterations; evaluated += kNumCharacters)
+				{
+					variant.mKernel(input, masks.data(), 0x80);
+					gSink = masks[evaluated % kNumCharacters];
+				}
+			});
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Main
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			gConfig.mOutFile = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			gConfig.mFilter = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+		{
+			gConfig.mIterations = std::strtoul(argv[++i], 0, 10);
+		}
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [--out <file>] [--filter <substring>] [--iterations <count>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	BenchmarkTransitions("sibling_transition", SiblingMode, 1);
+	BenchmarkTransitions("inner_transition", InnerMode, 2);
+	BenchmarkOversizedTransitions();
+	BenchmarkNoTransitions();
+	BenchmarkDispatchQueuedEvents();
+	BenchmarkInnerEntryRebuild();
+	BenchmarkUpdateStates();
+	BenchmarkLookups();
+	BenchmarkStateValues();
+	BenchmarkTransitionObjects();
+	BenchmarkStaticStateMachine();
+	BenchmarkTraversalPredicates();
+
+	if (gConfig.mOutFile)
+	{
+		FILE* file = std::fopen(gConfig.mOutFile, "w");
+		if (!file)
+		{
+			std::fprintf(stderr, "Could not open %s\n", gConfig.mOutFile);
+			return 1;
+		}
+		WriteResults(file);
+		std::fclose(file);
+	}
+	else
+	{
+		WriteResults(stdout);
+	}
+	return 0;
+}
@@ -2,6 +2,20 @@
 
 #include "Jumper.h"
 #include "Modules/ModuleManager.h"
+#include "States/StateTransitions.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Jumper, "Jumper" );
- 
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogJumperHSM);
+
+DEFINE_STAT(STAT_JumperStateTransitions);
+
+class FJumperModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		// The transition table is checked at compile time; this covers what depends on reflection data
+		ensureMsgf(JumperTransitions::ValidateAtStartup(), TEXT("Invalid Jumper state transition table, see the log for details"));
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FJumperModule, Jumper, "Jumper" );
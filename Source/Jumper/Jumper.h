@@ -3,3 +3,34 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+// State machine logging. Verbose per-transition messages are compiled out of Shipping and Test builds;
+// use the transition recorder (Jumper.StateMachine.DumpTransitions) to inspect transitions there.
+#if UE_BUILD_SHIPPING || UE_BUILD_TEST
+DECLARE_LOG_CATEGORY_EXTERN(LogJumperHSM, Log, Warning);
+#else
+DECLARE_LOG_CATEGORY_EXTERN(LogJumperHSM, Log, All);
+#endif
+
+DECLARE_STATS_GROUP(TEXT("Jumper"), STATGROUP_Jumper, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("State Transitions"), STAT_JumperStateTransitions, STATGROUP_Jumper, );
+
+// hsm.h debug tracing (see Jumper.StateMachine.TraceLevel) is only compiled into development builds
+#define HSM_DEBUG !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+// Profile hsm.h's UpdateStates and ProcessStateTransitions in the Jumper stat group. Include this file before hsm.h.
+#define HSM_PROFILE_SCOPE(Name) DECLARE_SCOPE_CYCLE_COUNTER(TEXT("HSM " #Name), STAT_Hsm##Name, STATGROUP_Jumper)
+
+// Jumper states are never nested, so a few inline state slots per machine are enough
+#define HSM_MAX_STACK_DEPTH 4
+
+// Every character has a StateValue undo log; Jumper states set movement parameters directly, so keep it small.
+// It holds JUMPER_MAX_STATE_VALUES_PER_STATE for each state of the deepest possible stack. StateValues set beyond
+// that are logged as errors and left as set when their state exits.
+#define JUMPER_MAX_STATE_VALUES_PER_STATE 2
+#define HSM_STATE_VALUE_CAPACITY (HSM_MAX_STACK_DEPTH * JUMPER_MAX_STATE_VALUES_PER_STATE)
+
+// hsm.h errors, such as an undo log overflow, are reported in all builds
+#define HSM_REPORT_ERROR(Message) UE_LOG(LogJumperHSM, Error, TEXT("%s"), ANSI_TO_TCHAR(Message))
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperBakeTraversalCommandlet.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Jumper.h"
+#include "JumperTraversalIndex.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+
+UJumperBakeTraversalCommandlet::UJumperBakeTraversalCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UJumperBakeTraversalCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString MapList;
+	if (!FParse::Value(*Params, TEXT("Maps="), MapList, false))
+	{
+		UE_LOG(LogJumperHSM, Error, TEXT("Usage: -run=JumperBakeTraversal -Maps=/Game/Map1+/Game/Map2"));
+		return 1;
+	}
+
+	TArray<FString> MapNames;
+	MapList.ParseIntoArray(MapNames, TEXT("+"));
+
+	int32 NumFailed = 0;
+	for (const FString& MapName : MapNames)
+	{
+		if (!BakeMap(MapName))
+		{
+			++NumFailed;
+		}
+	}
+	return NumFailed == 0 ? 0 : 1;
+#else
+	UE_LOG(LogJumperHSM, Error, TEXT("JumperBakeTraversal requires an editor build"));
+	return 1;
+#endif
+}
+
+bool UJumperBakeTraversalCommandlet::BakeMap(const FString& MapName)
+{
+#if WITH_EDITOR
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogJumperHSM, Error, TEXT("%s: could not load map"), *MapName);
+		return false;
+	}
+
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+	World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(false).CreateNavigation(false).CreateAISystem(false).ShouldSimulatePhysics(false));
+
+	// The index covers the sublevels too, so they must be loaded for the bake
+	World->LoadSecondaryLevels(true, nullptr);
+
+	AJumperTraversalIndex* Index = nullptr;
+	for (AActor* Actor : World->PersistentLevel->Actors)
+	{
+		if (AJumperTraversalIndex* LevelIndex = Cast<AJumperTraversalIndex>(Actor))
+		{
+			Index = LevelIndex;
+			break;
+		}
+	}
+
+	if (!Index)
+	{
+		Index = World->SpawnActor<AJumperTraversalIndex>();
+	}
+
+	bool bSaved = false;
+	if (Index)
+	{
+		Index->Bake();
+
+		const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetMapPackageExtension());
+		bSaved = UPackage::SavePackage(Package, World, RF_NoFlags, *Filename, GError, nullptr, false, true, SAVE_NoError);
+		UE_LOG(LogJumperHSM, Display, TEXT("%s: %s %d traversal faces"), *MapName, bSaved ? TEXT("saved") : TEXT("failed to save"), Index->GetNumFaces());
+	}
+
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(RF_NoFlags);
+
+	return bSaved;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "JumperBakeTraversalCommandlet.generated.h"
+
+/**
+ * Bakes the AJumperTraversalIndex of maps and saves them, e.g. as a build step after level edits:
+ *
+ *   UE4Editor-Cmd.exe Jumper.uproject -run=JumperBakeTraversal -Maps=/Game/World/Map1+/Game/World/Map2
+ *
+ * Maps without a traversal index get one. All of a map's sublevels are loaded and baked into it.
+ */
+UCLASS()
+class UJumperBakeTraversalCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UJumperBakeTraversalCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	bool BakeMap(const FString& MapName);
+};
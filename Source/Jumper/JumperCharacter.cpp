@@ -2,6 +2,7 @@
 
 #include "JumperCharacter.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
+#include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
@@ -9,11 +10,46 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "HAL/IConsoleManager.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "SignificanceManager.h"
 #include "CharMoveInterface.h"
+#include "JumperStateMachineSubsystem.h"
+#include "JumperTrace.h"
+#include "JumperTransitionRecorder.h"
+#include "JumperTraversalStore.h"
+#include "JumperTraversalIndex.h"
 #include "States/States.h"
 
+static TAutoConsoleVariable<int32> CVarJumperStateMachineTraceLevel(
+	TEXT("Jumper.StateMachine.TraceLevel"),
+	0,
+	TEXT("hsm debug trace level of Jumpers spawned from now on, logged to LogJumperHSM in development builds\n")
+	TEXT("0: none, 1: transitions, 2: transitions and state pops"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarJumperSignificance(
+	TEXT("Jumper.Significance"),
+	1,
+	TEXT("0: all Jumpers update at full rate\n")
+	TEXT("1: distant and off-screen Jumpers tick, move, probe and animate at reduced rates"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarJumperDormantIdle(
+	TEXT("Jumper.DormantIdle"),
+	1,
+	TEXT("0: idle Jumpers keep ticking\n")
+	TEXT("1: idle Jumpers that allow it (bAllowDormantIdle, never locally controlled ones) stop ticking without pending input, until input or a movement event wakes them"),
+	ECVF_Default);
+
+static const FName JumperSignificanceTag(TEXT("Jumper"));
+
+// Significance tiers, which are also the significance values reported to the significance manager
+static const int32 SignificanceTierLow = 0;
+static const int32 SignificanceTierMedium = 1;
+static const int32 SignificanceTierFull = 2;
+
 //////////////////////////////////////////////////////////////////////////
 // AJumperCharacter
 AJumperCharacter::AJumperCharacter()
@@ -48,7 +84,18 @@ AJumperCharacter::AJumperCharacter()
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
 
-	// Set up the state machine
+	// Let the mesh skip animation updates with screen size; distant tiers additionally stop ticking it off-screen
+	GetMesh()->bEnableUpdateRateOptimizations = true;
+
+	ProbeTraceDelegate.BindUObject(this, &AJumperCharacter::OnProbeTraceDone);
+
+	// Set up the state machine. States are constructed in the state stack's inline slots, and any state too large
+	// for one is pooled, so transitioning doesn't hit the heap. States only change mTransition through
+	// BaseState::Apply, which marks it dirty, so settled frames don't poll every state's GetTransition.
+	StateMachine.SetStatePoolingEnabled(true);
+	StateMachine.SetDirtyTransitionsEnabled(true);
+	StateMachine.SetTransitionCallback(&AJumperCharacter::OnStateTransition, this);
+	StateMachine.SetLogCallback(&AJumperCharacter::OnStateMachineLog, this);
 	StateMachine.Initialize<IdleState>(this);
 
 	PrimaryActorTick.bCanEverTick = true;
@@ -80,12 +127,256 @@ void AJumperCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerIn
 	PlayerInputComponent->BindAxis("LookUpRate", this, &AJumperCharacter::LookUpAtRate);
 }
 
+void AJumperCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if (USkeletalMeshComponent* MeshComponent = GetMesh())
+	{
+		MeshComponent->OnAnimInitialized.AddDynamic(this, &AJumperCharacter::CacheMoveAnimInstance);
+	}
+	CacheMoveAnimInstance();
+}
+
+void AJumperCharacter::CacheMoveAnimInstance()
+{
+	UAnimInstance* AnimInstance = GetMesh() ? GetMesh()->GetAnimInstance() : nullptr;
+	const bool bImplementsMoveInterface = AnimInstance && AnimInstance->GetClass()->ImplementsInterface(UCharMoveInterface::StaticClass());
+
+	MoveAnimInstance = bImplementsMoveInterface ? AnimInstance : nullptr;
+}
+
+void AJumperCharacter::NotifyMoveAnim(EMoveAnimNotify Notify, bool bActive)
+{
+	UObject* AnimInstance = MoveAnimInstance.Get();
+	if (!AnimInstance)
+	{
+		return;
+	}
+
+	switch (Notify)
+	{
+	case EMoveAnimNotify::GrabLedge:
+		Execute_GrabLedge(AnimInstance, bActive);
+		break;
+
+	case EMoveAnimNotify::ClimbingLedge:
+		Execute_ClimbingLedge(AnimInstance, bActive);
+		break;
+
+	case EMoveAnimNotify::WallSliding:
+		Execute_WallSliding(AnimInstance, bActive);
+		break;
+	}
+}
+
+void AJumperCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const int32 TraceLevel = FMath::Clamp(CVarJumperStateMachineTraceLevel.GetValueOnGameThread(), 0, static_cast<int32>(hsm::TraceLevel::Diagnostic));
+	StateMachine.SetDebugInfo(TCHAR_TO_ANSI(*GetName()), static_cast<hsm::TraceLevel::Type>(TraceLevel));
+
+	StateMachineSubsystem = GetWorld()->GetSubsystem<UJumperStateMachineSubsystem>();
+	if (StateMachineSubsystem)
+	{
+		StateMachineSubsystem->RegisterJumper(this);
+	}
+
+	DefaultAnimTickOption = GetMesh()->VisibilityBasedAnimTickOption;
+
+	if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld()))
+	{
+		SignificanceManager->RegisterObject(this, JumperSignificanceTag,
+			[](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+			{
+				return static_cast<const AJumperCharacter*>(ObjectInfo->GetObject())->CalculateSignificance(Viewpoint);
+			},
+			USignificanceManager::EPostSignificanceType::Sequential,
+			[](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+			{
+				if (OldSignificance != Significance)
+				{
+					static_cast<AJumperCharacter*>(ObjectInfo->GetObject())->ApplySignificance(static_cast<int32>(Significance));
+				}
+			});
+	}
+}
+
+void AJumperCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld()))
+	{
+		SignificanceManager->UnregisterObject(this);
+	}
+
+	if (StateMachineSubsystem)
+	{
+		StateMachineSubsystem->UnregisterJumper(this);
+		StateMachineSubsystem = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AJumperCharacter::Tick(float DeltaSeconds)
 {
+	// Event Tick runs in the parent class tick and notes the probes the Blueprint still traces itself
+	BlueprintProbes = ETraversalProbes::None;
+
 	Super::Tick(DeltaSeconds); // Call parent class tick function  
 
-	StateMachine.UpdateStates(static_cast<int>(EEventId::Tick));
-	StateMachine.ProcessStateTransitions();
+	LastTickFrame = GFrameCounter;
+
+	if (bUseNativeProbes)
+	{
+		ScheduleTraversalProbes();
+	}
+
+	if (!StateMachineSubsystem || !UJumperStateMachineSubsystem::IsBatchingEnabled())
+	{
+		TickStateMachine();
+	}
+
+	UpdateDormantIdle();
+}
+
+void AJumperCharacter::UpdateDormantIdle()
+{
+	if (!bAllowDormantIdle || CVarJumperDormantIdle.GetValueOnGameThread() == 0 || IsLocallyControlled())
+	{
+		return;
+	}
+
+	// Only Idle sleeps: other states without tick events, like Hanging, still rely on the actor tick (Blueprint Event
+	// Tick, probes). Idle is only left through an event, and every event is queued through QueueStateMachineEvent,
+	// which wakes the character first.
+	// Queued events are still dispatched later this frame when batched, and pending input is consumed by the movement
+	// component; both may lead to a state that wants ticking, so wait for the next tick to decide
+	if (!StateMachine.IsStarted() || !StateMachine.IsInState<IdleState>() || StateMachine.GetNumQueuedEvents() > 0
+		|| ActiveProbes != ETraversalProbes::None || !GetPendingMovementInputVector().IsZero() || WantsStateMachineTick())
+	{
+		return;
+	}
+
+	bDormantIdle = true;
+	SetActorTickEnabled(false);
+}
+
+void AJumperCharacter::WakeFromDormantIdle()
+{
+	if (bDormantIdle)
+	{
+		bDormantIdle = false;
+		SetActorTickEnabled(true);
+	}
+}
+
+void AJumperCharacter::TickStateMachine()
+{
+	// Events queued since the last tick are dispatched first, in the order they were received
+	if (WantsStateMachineTick())
+	{
+		QueueStateMachineEvent(EEventId::Tick);
+	}
+	StateMachine.DispatchQueuedEvents();
+}
+
+bool AJumperCharacter::WantsStateMachineTick()
+{
+	if (!StateMachine.IsStarted())
+	{
+		return true;
+	}
+
+	for (auto StateIter = StateMachine.BeginOuterToInner(); StateIter != StateMachine.EndOuterToInner(); ++StateIter)
+	{
+		if (static_cast<const BaseState*>(*StateIter)->WantsTickEvents())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void AJumperCharacter::CacheSignificanceInputs()
+{
+	// The player's own character, and everything while the feature is off, stays at full rate
+	bSignificanceAlwaysFull = IsLocallyControlled() || CVarJumperSignificance.GetValueOnGameThread() == 0;
+	bSignificanceRecentlyRendered = WasRecentlyRendered(0.5f);
+	SignificanceLocation = GetActorLocation();
+}
+
+float AJumperCharacter::CalculateSignificance(const FTransform& Viewpoint) const
+{
+	// Runs on worker threads, so only reads the inputs cached by CacheSignificanceInputs
+	if (bSignificanceAlwaysFull)
+	{
+		return SignificanceTierFull;
+	}
+
+	const float DistanceSquared = FVector::DistSquared(SignificanceLocation, Viewpoint.GetLocation());
+	int32 Tier = DistanceSquared > FMath::Square(SignificanceLowDistance) ? SignificanceTierLow
+		: DistanceSquared > FMath::Square(SignificanceMediumDistance) ? SignificanceTierMedium
+		: SignificanceTierFull;
+
+	if (!bSignificanceRecentlyRendered)
+	{
+		Tier = FMath::Max(Tier - 1, SignificanceTierLow);
+	}
+
+	return Tier;
+}
+
+void AJumperCharacter::ApplySignificance(int32 Tier)
+{
+	const float TickInterval = Tier == SignificanceTierLow ? SignificanceLowTickInterval
+		: Tier == SignificanceTierMedium ? SignificanceMediumTickInterval
+		: 0.0f;
+
+	SetActorTickInterval(TickInterval);
+	GetCharacterMovement()->SetComponentTickInterval(TickInterval);
+
+	ProbeStride = Tier == SignificanceTierLow ? 4 : Tier == SignificanceTierMedium ? 2 : 1;
+
+	GetMesh()->VisibilityBasedAnimTickOption = Tier == SignificanceTierFull ? DefaultAnimTickOption
+		: EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+}
+
+void AJumperCharacter::DecideStateMachineTick()
+{
+	if (StateMachine.GetNumQueuedEvents() > 0 || !StateMachine.IsStarted() || !WantsStateMachineTick())
+	{
+		return;
+	}
+
+	for (auto StateIter = StateMachine.BeginOuterToInner(); StateIter != StateMachine.EndOuterToInner(); ++StateIter)
+	{
+		static_cast<BaseState*>(*StateIter)->DecideAhead(EEventId::Tick);
+	}
+}
+
+void AJumperCharacter::QueueStateMachineEvent(EEventId EventId)
+{
+	const bool bWasDormant = bDormantIdle;
+	WakeFromDormantIdle();
+
+	if (!StateMachine.QueueEvent(static_cast<int>(EventId)))
+	{
+		UE_LOG(LogJumperHSM, Warning, TEXT("%s: state machine event queue full, dropped event %d"), *GetName(), static_cast<int>(EventId));
+	}
+
+	// The re-enabled actor tick may not run until next frame, and the batch skips characters that didn't tick, so
+	// the event that woke the character is handled right away rather than a frame late
+	if (bWasDormant)
+	{
+		StateMachine.DispatchQueuedEvents();
+	}
+}
+
+int32 AJumperCharacter::GetEventQueueHighWaterMark() const
+{
+	return static_cast<int32>(StateMachine.GetEventQueueHighWaterMark());
 }
 
 void AJumperCharacter::TurnAtRate(float Rate)
@@ -108,6 +399,8 @@ void AJumperCharacter::MoveForward(float Value)
 
 	if ((Controller != NULL) && (Value != 0.0f))
 	{
+		WakeFromDormantIdle();
+
 		// find out which way is forward
 		const FRotator Rotation = Controller->GetControlRotation();
 		const FRotator YawRotation(0, Rotation.Yaw, 0);
@@ -126,6 +419,8 @@ void AJumperCharacter::MoveRight(float Value)
 
 	if ( (Controller != NULL) && (Value != 0.0f) )
 	{
+		WakeFromDormantIdle();
+
 		// find out which way is right
 		const FRotator Rotation = Controller->GetControlRotation();
 		const FRotator YawRotation(0, Rotation.Yaw, 0);
@@ -139,19 +434,47 @@ void AJumperCharacter::MoveRight(float Value)
 
 void AJumperCharacter::CrouchEvent()
 {
-	StateMachine.UpdateStates(static_cast<int>(EEventId::Crouch));
-	StateMachine.ProcessStateTransitions();
+	QueueStateMachineEvent(EEventId::Crouch);
 }
 
 void AJumperCharacter::Jump()
 {
-	StateMachine.UpdateStates(static_cast<int>(EEventId::Jump));
-	StateMachine.ProcessStateTransitions();
+	QueueStateMachineEvent(EEventId::Jump);
 	
 	GetCharacterMovement()->bNotifyApex = true;
 }
 
 FTwoVectors AJumperCharacter::GetLedgeTraceStartEnd(float StartHeight, float Distance, float ForwardOffset)
+{
+	NoteBlueprintProbe(ETraversalProbes::Ledge);
+	return MakeLedgeProbeSegment(StartHeight, Distance, ForwardOffset);
+}
+
+FTwoVectors AJumperCharacter::GetWallTracerStartEnd(float ZOffset, float TraceLength)
+{
+	NoteBlueprintProbe(ETraversalProbes::Wall);
+	return MakeWallProbeSegment(ZOffset, TraceLength);
+}
+
+FTwoVectors AJumperCharacter::GetFloorTracerStartEnd(float Distance)
+{
+	NoteBlueprintProbe(ETraversalProbes::Floor);
+	return MakeFloorProbeSegment(Distance);
+}
+
+void AJumperCharacter::NoteBlueprintProbe(ETraversalProbes Probe)
+{
+	BlueprintProbes |= Probe;
+
+	if (bUseNativeProbes && !bWarnedBlueprintProbes)
+	{
+		bWarnedBlueprintProbes = true;
+		UE_LOG(LogJumperHSM, Warning, TEXT("%s: the Blueprint still traces probe %d itself although Use Native Probes is set; ")
+			TEXT("branch on it in Event Tick so the faster native probe takes over"), *GetName(), static_cast<int32>(Probe));
+	}
+}
+
+FTwoVectors AJumperCharacter::MakeLedgeProbeSegment(float StartHeight, float Distance, float ForwardOffset) const
 {
 	auto Location = GetActorLocation();
 	auto ForwardVector = GetActorForwardVector();
@@ -166,7 +489,7 @@ FTwoVectors AJumperCharacter::GetLedgeTraceStartEnd(float StartHeight, float Dis
 	return FTwoVectors(StartVector, EndVector);
 }
 
-FTwoVectors AJumperCharacter::GetWallTracerStartEnd(float ZOffset, float TraceLength)
+FTwoVectors AJumperCharacter::MakeWallProbeSegment(float ZOffset, float TraceLength) const
 {	
 	auto StartVector = GetActorLocation() + FVector(0.0f, 0.0f, ZOffset);
 	auto EndVector = StartVector + GetActorForwardVector() * TraceLength;
@@ -174,22 +497,265 @@ FTwoVectors AJumperCharacter::GetWallTracerStartEnd(float ZOffset, float TraceLe
 	return FTwoVectors(StartVector, EndVector);
 }
 
-bool AJumperCharacter::IsClimbing()
+FTwoVectors AJumperCharacter::MakeFloorProbeSegment(float Distance) const
 {
-	return (GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Flying);
+	auto StartLocation = GetActorLocation() + GetActorForwardVector();;
+	auto EndLocation = StartLocation - FVector(0.0f, 0.0f, Distance);
+
+	return FTwoVectors(StartLocation, EndLocation);
 }
 
-FRotator AJumperCharacter::AllignToWall()
+// Set in the user data of probe sweeps that only look for movable geometry, the rest having been answered by the traversal index
+static const uint32 IndexedProbeUserData = 1 << 8;
+
+DECLARE_CYCLE_STAT(TEXT("Schedule Traversal Probes"), STAT_JumperScheduleTraversalProbes, STATGROUP_Jumper);
+DECLARE_CYCLE_STAT(TEXT("Traversal Probe Results"), STAT_JumperTraversalProbeResults, STATGROUP_Jumper);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Probe Cache Hits"), STAT_JumperProbeCacheHits, STATGROUP_Jumper);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Probe Cache Misses"), STAT_JumperProbeCacheMisses, STATGROUP_Jumper);
+
+void AJumperCharacter::ScheduleTraversalProbes()
 {
-	return UKismetMathLibrary::MakeRotFromXZ(WallNormal * -1, GetActorUpVector());
+	SCOPE_CYCLE_COUNTER(STAT_JumperScheduleTraversalProbes);
+
+	// Gather what the states on the stack need
+	ETraversalProbes RequiredProbes = ETraversalProbes::None;
+	int32 ProbeInterval = MAX_int32;
+	for (auto StateIter = StateMachine.BeginOuterToInner(); StateIter != StateMachine.EndOuterToInner(); ++StateIter)
+	{
+		const BaseState* State = static_cast<const BaseState*>(*StateIter);
+		if (State->GetRequiredProbes() != ETraversalProbes::None)
+		{
+			RequiredProbes |= State->GetRequiredProbes();
+			ProbeInterval = FMath::Min(ProbeInterval, State->GetProbeInterval());
+		}
+	}
+
+	// Probes the Blueprint traced this tick are its own; tracing them again would only be overwritten by, or overwrite, its result
+	RequiredProbes &= ~BlueprintProbes;
+
+	// Results of probes that are no longer refreshed would go stale, so clear them
+	const ETraversalProbes DroppedProbes = ActiveProbes & ~RequiredProbes & ~BlueprintProbes;
+	if (EnumHasAnyFlags(DroppedProbes, ETraversalProbes::Floor))
+	{
+		SetProbeResult(ETraversalProbes::Floor, nullptr);
+	}
+	if (EnumHasAnyFlags(DroppedProbes, ETraversalProbes::Wall))
+	{
+		SetProbeResult(ETraversalProbes::Wall, nullptr);
+	}
+	if (EnumHasAnyFlags(DroppedProbes, ETraversalProbes::Ledge))
+	{
+		SetProbeResult(ETraversalProbes::Ledge, nullptr);
+	}
+	ActiveProbes = RequiredProbes;
+	if (!EnumHasAnyFlags(RequiredProbes, ETraversalProbes::Wall))
+	{
+		WallProbeCache.Invalidate();
+	}
+	if (!EnumHasAnyFlags(RequiredProbes, ETraversalProbes::Ledge))
+	{
+		LedgeProbeCache.Invalidate();
+	}
+
+	if (RequiredProbes == ETraversalProbes::None)
+	{
+		return;
+	}
+
+	// Spread characters on reduced probe rates over different ticks. Counted per character rather than by frame,
+	// as characters on a reduced tick rate don't schedule every frame.
+	const uint32 ScheduleInterval = static_cast<uint32>(ProbeInterval) * static_cast<uint32>(ProbeStride);
+	if (ScheduleInterval > 1 && (ProbeScheduleCounter++ + GetUniqueID()) % ScheduleInterval != 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+
+	const AJumperTraversalIndex* TraversalIndex = bUseTraversalIndex && StateMachineSubsystem ? StateMachineSubsystem->GetTraversalIndex() : nullptr;
+
+	// Same sweeps as the Blueprint's sphere traces: simple collision, ignoring this character
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(JumperTraversalProbe), false, this);
+	const FCollisionShape ProbeShape = FCollisionShape::MakeSphere(ProbeSphereRadius);
+
+	if (EnumHasAnyFlags(RequiredProbes, ETraversalProbes::Floor))
+	{
+		const FTwoVectors FloorTrace = MakeFloorProbeSegment(FloorProbeDistance);
+		World->AsyncSweepByChannel(EAsyncTraceType::Single, FloorTrace.v1, FloorTrace.v2, FQuat::Identity, FloorProbeChannel, ProbeShape, QueryParams,
+			FCollisionResponseParams::DefaultResponseParam, &ProbeTraceDelegate, static_cast<uint32>(ETraversalProbes::Floor));
+	}
+
+	// Wall and ledge probes reuse their last result while they haven't moved far enough for it to change. Otherwise the
+	// static geometry is answered right away by the level's baked index, where it holds all of it, and only movable
+	// geometry is swept for.
+	auto ScheduleCachedProbe = [&](ETraversalProbes Probe, const FTwoVectors& Trace, ECollisionChannel Channel)
+	{
+		const FJumperProbeCache& Cache = Probe == ETraversalProbes::Wall ? WallProbeCache : LedgeProbeCache;
+		FHitResult CachedHit;
+		bool bCachedHit = false;
+		if (Cache.Reuse(Trace.v1, Trace.v2, CachedHit, bCachedHit))
+		{
+			INC_DWORD_STAT(STAT_JumperProbeCacheHits);
+			SetProbeResult(Probe, bCachedHit ? &CachedHit : nullptr);
+			return;
+		}
+		INC_DWORD_STAT(STAT_JumperProbeCacheMisses);
+
+		FCollisionQueryParams ProbeQueryParams = QueryParams;
+		uint32 UserData = static_cast<uint32>(Probe);
+
+		if (TraversalIndex && TraversalIndex->CanSweep(Channel, Trace.v1, Trace.v2, ProbeSphereRadius))
+		{
+			FHitResult IndexHit;
+			const bool bIndexHit = TraversalIndex->Sweep(Trace.v1, Trace.v2, ProbeSphereRadius, IndexHit);
+			SetProbeResult(Probe, bIndexHit ? &IndexHit : nullptr, &Trace);
+			(Probe == ETraversalProbes::Wall ? WallIndexHitTime : LedgeIndexHitTime) = bIndexHit ? IndexHit.Time : MAX_flt;
+
+			ProbeQueryParams.MobilityType = EQueryMobilityType::Dynamic;
+			UserData |= IndexedProbeUserData;
+		}
+
+		World->AsyncSweepByChannel(EAsyncTraceType::Single, Trace.v1, Trace.v2, FQuat::Identity, Channel, ProbeShape, ProbeQueryParams,
+			FCollisionResponseParams::DefaultResponseParam, &ProbeTraceDelegate, UserData);
+	};
+
+	if (EnumHasAnyFlags(RequiredProbes, ETraversalProbes::Wall))
+	{
+		ScheduleCachedProbe(ETraversalProbes::Wall, MakeWallProbeSegment(WallProbeZOffset, WallProbeLength), WallProbeChannel);
+	}
+
+	if (EnumHasAnyFlags(RequiredProbes, ETraversalProbes::Ledge))
+	{
+		ScheduleCachedProbe(ETraversalProbes::Ledge, MakeLedgeProbeSegment(LedgeProbeStartHeight, LedgeProbeDistance, LedgeProbeForwardOffset), LedgeProbeChannel);
+	}
 }
 
-FTwoVectors AJumperCharacter::GetFloorTracerStartEnd(float Distance)
+void AJumperCharacter::OnProbeTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData)
 {
-	auto StartLocation = GetActorLocation() + GetActorForwardVector();;
-	auto EndLocation = StartLocation - FVector(0.0f, 0.0f, Distance);
+	SCOPE_CYCLE_COUNTER(STAT_JumperTraversalProbeResults);
 
-	return FTwoVectors(StartLocation, EndLocation);
+	const FHitResult* Hit = TraceData.OutHits.Num() > 0 && TraceData.OutHits[0].bBlockingHit ? &TraceData.OutHits[0] : nullptr;
+
+	const ETraversalProbes Probe = static_cast<ETraversalProbes>(TraceData.UserData & ~IndexedProbeUserData);
+
+	// Ignore results that arrive after the active states stopped needing them
+	if (!EnumHasAnyFlags(ActiveProbes, Probe))
+	{
+		return;
+	}
+
+	// A sweep for movable geometry only replaces the traversal index's result if it hit something nearer
+	if ((TraceData.UserData & IndexedProbeUserData) != 0
+		&& (!Hit || Hit->Time >= (Probe == ETraversalProbes::Wall ? WallIndexHitTime : LedgeIndexHitTime)))
+	{
+		return;
+	}
+
+	const FTwoVectors Trace(TraceData.Start, TraceData.End);
+	SetProbeResult(Probe, Hit, &Trace);
+}
+
+void AJumperCharacter::SetProbeResult(ETraversalProbes Probe, const FHitResult* Hit, const FTwoVectors* Trace)
+{
+	// Movable geometry can change under a probe that stays still, so such hits are traced again next time
+	if (Trace && Probe != ETraversalProbes::Floor)
+	{
+		const UPrimitiveComponent* HitComponent = Hit ? Hit->GetComponent() : nullptr;
+		const bool bHitIsStatic = !HitComponent || HitComponent->Mobility == EComponentMobility::Static;
+		FJumperProbeCache& Cache = Probe == ETraversalProbes::Wall ? WallProbeCache : LedgeProbeCache;
+		Cache.Store(Trace->v1, Trace->v2, Hit, bHitIsStatic, ProbeCacheDistance);
+	}
+
+	FJumperTraversalStore* Store = TraversalHandle != INDEX_NONE ? &StateMachineSubsystem->GetTraversalStore() : nullptr;
+
+	// The Blueprint-facing properties and the subsystem's traversal store are kept in sync
+	switch (Probe)
+	{
+	case ETraversalProbes::Floor:
+		IsNearFloor = Hit != nullptr;
+		if (Store)
+		{
+			Store->SetFlag(TraversalHandle, EJumperTraversalFlags::NearFloor, IsNearFloor);
+		}
+		break;
+
+	case ETraversalProbes::Wall:
+		IsNearWall = Hit != nullptr;
+		if (Hit)
+		{
+			WallTraceImpact = Hit->ImpactPoint;
+			WallNormal = Hit->ImpactNormal;
+		}
+		if (Store)
+		{
+			Store->SetFlag(TraversalHandle, EJumperTraversalFlags::NearWall, IsNearWall);
+			Store->WallImpactX[TraversalHandle] = WallTraceImpact.X;
+			Store->WallImpactY[TraversalHandle] = WallTraceImpact.Y;
+			Store->WallImpactZ[TraversalHandle] = WallTraceImpact.Z;
+			Store->WallNormalX[TraversalHandle] = WallNormal.X;
+			Store->WallNormalY[TraversalHandle] = WallNormal.Y;
+			Store->WallNormalZ[TraversalHandle] = WallNormal.Z;
+		}
+		break;
+
+	case ETraversalProbes::Ledge:
+		IsNearLedgeHeight = Hit != nullptr;
+		if (Hit)
+		{
+			LedgeHeight = Hit->ImpactPoint;
+		}
+		if (Store)
+		{
+			Store->SetFlag(TraversalHandle, EJumperTraversalFlags::NearLedge, IsNearLedgeHeight);
+			Store->LedgeHeightX[TraversalHandle] = LedgeHeight.X;
+			Store->LedgeHeightY[TraversalHandle] = LedgeHeight.Y;
+			Store->LedgeHeightZ[TraversalHandle] = LedgeHeight.Z;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+EJumperTraversalPredicates AJumperCharacter::GetTraversalPredicates() const
+{
+	return TraversalHandle != INDEX_NONE ? StateMachineSubsystem->GetTraversalStore().GetPredicates(TraversalHandle) : EJumperTraversalPredicates::None;
+}
+
+void AJumperCharacter::OnStateTransition(hsm::StateMachine& Machine, const hsm::TransitionEvent& Event, void* UserData)
+{
+	INC_DWORD_STAT(STAT_JumperStateTransitions);
+
+	const AJumperCharacter* Jumper = static_cast<const AJumperCharacter*>(UserData);
+
+	// The batch-evaluated traversal predicates were decided for the previous state
+	if (Jumper->TraversalHandle != INDEX_NONE)
+	{
+		Jumper->StateMachineSubsystem->GetTraversalStore().Predicates[Jumper->TraversalHandle] = EJumperTraversalPredicates::None;
+	}
+
+	EState FromState, ToState;
+	const uint8 From = Event.mSourceStateType.IsValid() && GetStateEnum(Event.mSourceStateType, FromState) ? static_cast<uint8>(FromState) : JumperTraceNoState;
+	const uint8 To = GetStateEnum(Event.mTargetStateType, ToState) ? static_cast<uint8>(ToState) : JumperTraceNoState;
+
+	TraceJumperStateTransition(Jumper->GetUniqueID(), From, To, static_cast<uint8>(Event.mDepth));
+	FJumperTransitionRecorder::Get().Record(Jumper->GetUniqueID(), From, To, static_cast<uint8>(Event.mDepth));
+}
+
+void AJumperCharacter::OnStateMachineLog(const hsm::StateMachine& Machine, hsm::TraceLevel::Type Level, const hsm_char* Line, void* UserData)
+{
+	UE_LOG(LogJumperHSM, Log, TEXT("%s"), ANSI_TO_TCHAR(Line));
+}
+
+bool AJumperCharacter::IsClimbing()
+{
+	return (GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Flying);
+}
+
+FRotator AJumperCharacter::AllignToWall()
+{
+	return UKismetMathLibrary::MakeRotFromXZ(WallNormal * -1, GetActorUpVector());
 }
 
 void AJumperCharacter::Landed(const FHitResult& Hit)
@@ -197,6 +763,10 @@ void AJumperCharacter::Landed(const FHitResult& Hit)
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f);
 	GetCharacterMovement()->GravityScale = 1.0f;
 	GetCharacterMovement()->bNotifyApex = true;
+
+	// Queued rather than read from the movement mode, so the landing isn't missed when the character is
+	// walking off a ledge again by the time the state machine ticks
+	QueueStateMachineEvent(EEventId::Landed);
 }
 
 void AJumperCharacter::NotifyJumpApex()
@@ -208,6 +778,13 @@ void AJumperCharacter::NotifyJumpApex()
 	}
 }
 
+void AJumperCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	QueueStateMachineEvent(EEventId::MovementModeChanged);
+}
+
 FVector AJumperCharacter::WallGoToLocation(float HeightOffset, float NormalOffset)
 {
 	float X = WallTraceImpact.X + WallNormal.X * NormalOffset;
@@ -4,14 +4,26 @@
 #include "GameFramework/Character.h"
 #include "CharMoveInterface.h"
 #include "Components/TimelineComponent.h"
+#include "Jumper.h"
 #include "hsm.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "WorldCollision.h"
+#include "JumperProbeCache.h"
+#include "JumperTraversalStore.h"
 #include "States/StateEnum.h"
 #include "JumperCharacter.generated.h"
 
 using namespace hsm;
 
+/** Animation blueprint notifications of ICharMoveInterface */
+enum class EMoveAnimNotify : uint8
+{
+	GrabLedge,
+	ClimbingLedge,
+	WallSliding
+};
+
 UCLASS(config=Game)
 class AJumperCharacter : public ACharacter, public ICharMoveInterface
 {
@@ -48,6 +60,13 @@ public:
 
 	virtual void NotifyJumpApex() override;
 
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
+
+	virtual void PostInitializeComponents() override;
+
+	/** Forwards a notification to the animation blueprint, if it implements ICharMoveInterface */
+	void NotifyMoveAnim(EMoveAnimNotify Notify, bool bActive);
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
 
@@ -82,8 +101,118 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab")
 	float LedgeGrabNormalOffset = 100.0f;
 
+	// Traversal probes. When enabled, the floor, wall and ledge traces run asynchronously from C++ and their
+	// results are written to the Wall Grab variables above one frame later. The defaults match the sphere traces
+	// of the Jumper Blueprint's Event Tick, which must branch on this flag around them: a probe the Blueprint still
+	// builds through the Get*StartEnd functions in a tick is left to the Blueprint for that tick, so the two never
+	// trace the same probe or overwrite each other's results.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	bool bUseNativeProbes = true;
+
+	/** Radius of the probe sphere sweeps */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes", meta = (ClampMin = "0.0"))
+	float ProbeSphereRadius = 20.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Wall Grab|Probes")
+	TEnumAsByte<ECollisionChannel> FloorProbeChannel = ECC_Visibility;
+
+	UPROPERTY(EditAnywhere, Category = "Wall Grab|Probes")
+	TEnumAsByte<ECollisionChannel> WallProbeChannel = ECC_Visibility;
+
+	UPROPERTY(EditAnywhere, Category = "Wall Grab|Probes")
+	TEnumAsByte<ECollisionChannel> LedgeProbeChannel = ECC_GameTraceChannel3;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float FloorProbeDistance = 90.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float WallProbeZOffset = 50.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float WallProbeLength = 100.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float LedgeProbeStartHeight = 600.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float LedgeProbeDistance = 550.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	float LedgeProbeForwardOffset = 50.0f;
+
+	/**
+	 * Largest distance the wall and ledge probes may move and still reuse their last hit without tracing again. A hit is
+	 * reused while the probe has moved less than both this and the length of the probe left beyond the hit; misses and
+	 * hits on movable geometry are traced again as soon as the probe moves. Keep it below the size of the walls and
+	 * ledges the probes look for, as the hit surface is assumed to extend this far around the impact point.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes", meta = (ClampMin = "0.0"))
+	float ProbeCacheDistance = 25.0f;
+
+	/**
+	 * Answer the wall and ledge probes from the level's baked AJumperTraversalIndex, when it has one and it holds the
+	 * static geometry around the probe, and only sweep for movable geometry
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Wall Grab|Probes")
+	bool bUseTraversalIndex = true;
+
+	// Significance. Jumpers that are not locally controlled drop to a lower tier with distance from the nearest player
+	// viewpoint, and one tier further while off-screen. Lower tiers tick the actor and its movement less often, probe
+	// less often and stop updating animation while not rendered.
+	UPROPERTY(EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float SignificanceMediumDistance = 3000.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float SignificanceLowDistance = 8000.0f;
+
+	/** Actor and movement tick interval of the medium tier */
+	UPROPERTY(EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float SignificanceMediumTickInterval = 1.0f / 30.0f;
+
+	/** Actor and movement tick interval of the low tier */
+	UPROPERTY(EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float SignificanceLowTickInterval = 0.1f;
+
+	/**
+	 * Disable the actor tick while idle with no movement input, until input, a movement mode change or another state
+	 * machine event wakes the character. Meant for crowd characters: Blueprint Event Tick doesn't run while dormant,
+	 * and locally controlled characters never go dormant.
+	 */
+	UPROPERTY(EditAnywhere, Category = "State Machine")
+	bool bAllowDormantIdle = false;
+
 	virtual void Tick(float DeltaSeconds) override;
 
+	/** Dispatches queued events, followed by the Tick event if an active state wants it, to the state machine */
+	void TickStateMachine();
+
+	/**
+	 * Runs the decide phase of the states' Tick update ahead of TickStateMachine, which then only applies the
+	 * decisions. Only reads the character, so it may run on a worker thread while the game thread waits.
+	 * Does nothing if input events are queued, as those must be handled in order on the game thread.
+	 */
+	void DecideStateMachineTick();
+
+	/** Handle of this character's entry in the subsystem's traversal store; INDEX_NONE while not registered */
+	int32 GetTraversalHandle() const { return TraversalHandle; }
+	void SetTraversalHandle(int32 Handle) { TraversalHandle = Handle; }
+
+	/** Traversal predicates evaluated in batch for this frame; None (without the Valid flag) if unavailable */
+	EJumperTraversalPredicates GetTraversalPredicates() const;
+
+	/**
+	 * Snapshots what CalculateSignificance reads from the character and the world, on the game thread ahead of the
+	 * significance manager's update, which may calculate significance on worker threads
+	 */
+	void CacheSignificanceInputs();
+
+	/** Returns true if the actor ticked this frame; characters on a reduced tick rate skip frames */
+	bool HasTickedThisFrame() const { return LastTickFrame == GFrameCounter; }
+
+	/** Largest number of state machine events that were queued within a single tick */
+	UFUNCTION(BlueprintCallable, Category = "State Machine")
+	int32 GetEventQueueHighWaterMark() const;
+
 protected:
 	/** Called for forwards/backward input */
 	void MoveForward(float Value);
@@ -107,9 +236,105 @@ protected:
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
 
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
 	void CrouchEvent();
 
+	/** Queues an event to be dispatched to the state machine on the next tick */
+	void QueueStateMachineEvent(EEventId EventId);
+
+	/** Returns true if a state on the stack handles the Tick event, or the machine hasn't started yet */
+	bool WantsStateMachineTick();
+
+	/** Disables the actor tick if nothing needs it: no state wants the Tick event or probes, and no events or input are pending */
+	void UpdateDormantIdle();
+
+	/** Re-enables the actor tick if UpdateDormantIdle disabled it */
+	void WakeFromDormantIdle();
+
+	/**
+	 * Kicks off the async traces for the probes the active states need, except those the Blueprint traced itself this
+	 * tick; results arrive in OnProbeTraceDone next frame
+	 */
+	void ScheduleTraversalProbes();
+
+	/** Probe segments, shared by the native probes and the Blueprint-callable Get*StartEnd functions */
+	FTwoVectors MakeLedgeProbeSegment(float StartHeight, float Distance, float ForwardOffset) const;
+	FTwoVectors MakeWallProbeSegment(float ZOffset, float TraceLength) const;
+	FTwoVectors MakeFloorProbeSegment(float Distance) const;
+
+	/** Records that the Blueprint built a probe segment this tick, so the native probe leaves it to the Blueprint */
+	void NoteBlueprintProbe(ETraversalProbes Probe);
+
+	void OnProbeTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData);
+
+	/** Significance tier (2 full rate, 1 medium, 0 low) of this character seen from a player viewpoint */
+	float CalculateSignificance(const FTransform& Viewpoint) const;
+
+	/** Sets the tick intervals, probe stride and animation tick option of a significance tier */
+	void ApplySignificance(int32 Tier);
+
+	/**
+	 * Stores a probe result (Hit is null for a miss) in the Wall Grab variables and the traversal store. Trace is the
+	 * segment a fresh wall or ledge result was traced along, which caches it for the following ticks.
+	 */
+	void SetProbeResult(ETraversalProbes Probe, const FHitResult* Hit, const FTwoVectors* Trace = nullptr);
+
+	/** Counts each state machine transition, emits it to Unreal Insights and records it in FJumperTransitionRecorder */
+	static void OnStateTransition(hsm::StateMachine& Machine, const hsm::TransitionEvent& Event, void* UserData);
+
+	/** Routes hsm debug trace output to LogJumperHSM */
+	static void OnStateMachineLog(const hsm::StateMachine& Machine, hsm::TraceLevel::Type Level, const hsm_char* Line, void* UserData);
+
+	FTraceDelegate ProbeTraceDelegate;
+
+	/** Looks up the anim instance that receives ICharMoveInterface notifications; called whenever the mesh reinitializes its anim instance */
+	UFUNCTION()
+	void CacheMoveAnimInstance();
+
+	/** Mesh anim instance if it implements ICharMoveInterface, null otherwise (or before it exists, e.g. on dedicated servers) */
+	TWeakObjectPtr<UObject> MoveAnimInstance;
+
+	/** Probes traced on the last scheduled frame; results of probes that stop being traced are cleared */
+	ETraversalProbes ActiveProbes = ETraversalProbes::None;
+
+	/** Last traced results of the wall and ledge probes, reused while the probes move less than ProbeCacheDistance */
+	FJumperProbeCache WallProbeCache;
+	FJumperProbeCache LedgeProbeCache;
+
+	/** Time of the traversal index hit of the wall and ledge probes answered from the index, MAX_flt for a miss */
+	float WallIndexHitTime = MAX_flt;
+	float LedgeIndexHitTime = MAX_flt;
+
+	/** Probes the Blueprint traced itself since the start of this tick */
+	ETraversalProbes BlueprintProbes = ETraversalProbes::None;
+
+	/** Set once the Blueprint traced a probe while native probes are enabled, so that is only warned about once */
+	bool bWarnedBlueprintProbes = false;
+
+	/** Probes run on every ProbeStride-th scheduling; raised by lower significance tiers */
+	int32 ProbeStride = 1;
+
+	/** Counts probe schedulings, for spreading reduced probe rates over ticks */
+	uint32 ProbeScheduleCounter = 0;
+
+	/** Inputs of CalculateSignificance, set by CacheSignificanceInputs; until then the character stays at full rate */
+	FVector SignificanceLocation = FVector::ZeroVector;
+	bool bSignificanceAlwaysFull = true;
+	bool bSignificanceRecentlyRendered = true;
+
+	/** Mesh animation tick option of the full rate tier */
+	EVisibilityBasedAnimTickOption DefaultAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+
+	/** Frame of the last actor Tick */
+	uint64 LastTickFrame = 0;
+
+	/** True while the actor tick is disabled by UpdateDormantIdle */
+	bool bDormantIdle = false;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
@@ -120,6 +345,12 @@ private:
 
 	UTimelineComponent* SlideTimeline;
 
+	/** Subsystem this character is registered with, from BeginPlay to EndPlay */
+	UPROPERTY(Transient)
+	class UJumperStateMachineSubsystem* StateMachineSubsystem = nullptr;
+
+	int32 TraversalHandle = INDEX_NONE;
+
 	// State Machine
 	friend struct BaseState;
 	friend struct JumpingState;
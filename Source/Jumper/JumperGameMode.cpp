@@ -5,6 +5,9 @@
 #include "UObject/ConstructorHelpers.h"
 //#include "hsm.h"
 #include "GameFramework/HUD.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "TimerManager.h"
 
 AJumperGameMode::AJumperGameMode()
 {
@@ -21,3 +24,60 @@ AJumperGameMode::AJumperGameMode()
 	}
 	
 }
+
+void AJumperGameMode::SpawnJumperCrowd(int32 Count, float Spacing, int32 Seed)
+{
+	CrowdRandom.Initialize(Seed);
+
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+	const FVector Origin = PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+
+	UClass* JumperClass = DefaultPawnClass && DefaultPawnClass->IsChildOf<AJumperCharacter>() ? *DefaultPawnClass : AJumperCharacter::StaticClass();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count)));
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FVector Offset((Index % Columns + 1) * Spacing, (Index / Columns - Columns / 2) * Spacing, 0.0f);
+		AJumperCharacter* Jumper = GetWorld()->SpawnActor<AJumperCharacter>(JumperClass, Origin + Offset, FRotator::ZeroRotator, SpawnParams);
+		if (Jumper)
+		{
+			// Nobody possesses the crowd, so movement has to simulate without a controller
+			Jumper->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+			Crowd.Add(Jumper);
+		}
+	}
+
+	if (!CrowdJumpTimer.IsValid())
+	{
+		GetWorldTimerManager().SetTimer(CrowdJumpTimer, this, &AJumperGameMode::MakeCrowdJump, 0.25f, true);
+	}
+}
+
+void AJumperGameMode::DestroyJumperCrowd()
+{
+	GetWorldTimerManager().ClearTimer(CrowdJumpTimer);
+
+	for (AJumperCharacter* Jumper : Crowd)
+	{
+		if (Jumper)
+		{
+			Jumper->Destroy();
+		}
+	}
+	Crowd.Reset();
+}
+
+void AJumperGameMode::MakeCrowdJump()
+{
+	// Keep a share of the crowd going through the jumping states
+	for (AJumperCharacter* Jumper : Crowd)
+	{
+		if (Jumper && CrowdRandom.FRand() < 0.1f)
+		{
+			Jumper->Jump();
+		}
+	}
+}
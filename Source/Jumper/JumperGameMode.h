@@ -13,6 +13,28 @@ class AJumperGameMode : public AGameModeBase
 
 public:
 	AJumperGameMode();
+
+	/**
+	 * Spawns Count uncontrolled Jumpers on a grid around the player that jump at random, to measure state machine
+	 * cost at crowd scale. Compare "stat game" with Jumper.StateMachine.Batched set to 0 and 1, or run the
+	 * Jumper.Crowd.StateMachineBatching automation test. The same Seed makes the same Jumpers jump in the same order.
+	 */
+	UFUNCTION(Exec)
+	void SpawnJumperCrowd(int32 Count = 1000, float Spacing = 150.0f, int32 Seed = 1);
+
+	UFUNCTION(Exec)
+	void DestroyJumperCrowd();
+
+private:
+	void MakeCrowdJump();
+
+	UPROPERTY(Transient)
+	TArray<class AJumperCharacter*> Crowd;
+
+	FTimerHandle CrowdJumpTimer;
+
+	/** Picks the Jumpers that jump; seeded by SpawnJumperCrowd */
+	FRandomStream CrowdRandom;
 };
 
 
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+/**
+ * Last result of a wall or ledge probe, and how far the probe may move before it has to be traced again.
+ *
+ * A hit on static geometry at distance D along a probe of length L stays a hit while the probe moves less than
+ * L - D: the surface can't have moved out of reach. Its impact point slides along the surface with the probe.
+ * The bound assumes the surface extends that far around the impact point, so it is also capped by MaxDistance,
+ * which keeps it within the size of the walls and ledges the probes look for. A miss only says the probe's own
+ * segment was clear, so it is reused only while the probe doesn't move at all.
+ */
+struct FJumperProbeCache
+{
+	/** Caches a freshly traced result; Hit is null for a miss. Hits on geometry that may move aren't cached. */
+	void Store(const FVector& Start, const FVector& End, const FHitResult* Hit, bool bHitIsStatic, float MaxDistance)
+	{
+		if (Hit && !bHitIsStatic)
+		{
+			Invalidate();
+			return;
+		}
+
+		bValid = true;
+		bHit = Hit != nullptr;
+		CachedStart = Start;
+		CachedEnd = End;
+		if (Hit)
+		{
+			ImpactPoint = Hit->ImpactPoint;
+			ImpactNormal = Hit->ImpactNormal;
+			HitTime = Hit->Time;
+			ValidDistance = FMath::Min(MaxDistance, (End - Start).Size() * (1.0f - Hit->Time));
+		}
+		else
+		{
+			ValidDistance = 0.0f;
+		}
+	}
+
+	/**
+	 * Returns true if the cached result still holds for the probe segment Start - End, with bOutHit set and, for a hit,
+	 * OutHit filled with the impact moved along with the probe
+	 */
+	bool Reuse(const FVector& Start, const FVector& End, FHitResult& OutHit, bool& bOutHit) const
+	{
+		if (!bValid)
+		{
+			return false;
+		}
+
+		// Turning moves the far end of the probe further than the near one
+		const FVector StartDelta = Start - CachedStart;
+		const float MovedSquared = FMath::Max(StartDelta.SizeSquared(), (End - CachedEnd).SizeSquared());
+		if (MovedSquared > FMath::Square(ValidDistance))
+		{
+			return false;
+		}
+
+		bOutHit = bHit;
+		if (bHit)
+		{
+			const FVector Slide = StartDelta - (StartDelta | ImpactNormal) * ImpactNormal;
+			OutHit = FHitResult(nullptr, nullptr, ImpactPoint + Slide, ImpactNormal);
+			OutHit.bBlockingHit = true;
+			OutHit.Time = HitTime;
+			OutHit.TraceStart = Start;
+			OutHit.TraceEnd = End;
+		}
+		return true;
+	}
+
+	void Invalidate() { bValid = false; }
+
+	bool IsValid() const { return bValid; }
+
+private:
+	FVector CachedStart = FVector::ZeroVector;
+	FVector CachedEnd = FVector::ZeroVector;
+	FVector ImpactPoint = FVector::ZeroVector;
+	FVector ImpactNormal = FVector::UpVector;
+	float HitTime = 1.0f;
+
+	/** How far either end of the probe may move from where it was traced before the result is stale */
+	float ValidDistance = 0.0f;
+
+	bool bValid = false;
+	bool bHit = false;
+};
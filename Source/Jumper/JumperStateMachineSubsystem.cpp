@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperStateMachineSubsystem.h"
+#include "JumperCharacter.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "SignificanceManager.h"
+
+static TAutoConsoleVariable<int32> CVarJumperBatchedStateMachines(
+	TEXT("Jumper.StateMachine.Batched"),
+	1,
+	TEXT("0: each Jumper updates its state machine from its own Tick\n")
+	TEXT("1: Jumper state machines are updated in batches by UJumperStateMachineSubsystem"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarJumperParallelDecide(
+	TEXT("Jumper.StateMachine.ParallelDecide"),
+	1,
+	TEXT("0: batched Jumper states decide and apply their update on the game thread\n")
+	TEXT("1: batched Jumper states decide on worker threads, then apply on the game thread"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarJumperTraversalStore(
+	TEXT("Jumper.TraversalStore"),
+	1,
+	TEXT("0: Jumper states evaluate their traversal checks on each character\n")
+	TEXT("1: traversal checks are evaluated in one pass over the subsystem's packed traversal store"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Batched State Machine Update"), STAT_JumperBatchedStateMachineUpdate, STATGROUP_Jumper);
+DECLARE_CYCLE_STAT(TEXT("Batched State Machine Decide"), STAT_JumperBatchedStateMachineDecide, STATGROUP_Jumper);
+DECLARE_CYCLE_STAT(TEXT("Traversal Store Predicates"), STAT_JumperTraversalStorePredicates, STATGROUP_Jumper);
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_JumperSignificanceUpdate, STATGROUP_Jumper);
+
+bool UJumperStateMachineSubsystem::IsBatchingEnabled()
+{
+	return CVarJumperBatchedStateMachines.GetValueOnGameThread() != 0;
+}
+
+void FJumperBatchTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem)
+	{
+		Subsystem->Tick(DeltaTime);
+	}
+}
+
+FString FJumperBatchTickFunction::DiagnosticMessage()
+{
+	return TEXT("UJumperStateMachineSubsystem batch tick");
+}
+
+void UJumperStateMachineSubsystem::RegisterJumper(AJumperCharacter* Jumper)
+{
+	check(Jumper);
+	if (Jumper->GetTraversalHandle() != INDEX_NONE)
+	{
+		return;
+	}
+
+	// Registered on the first character, as the world's persistent level exists by the time characters begin play
+	if (!BatchTickFunction.IsTickFunctionRegistered())
+	{
+		BatchTickFunction.Subsystem = this;
+		BatchTickFunction.TickGroup = TG_PrePhysics;
+		BatchTickFunction.bCanEverTick = true;
+		BatchTickFunction.bStartWithTickEnabled = false;
+		BatchTickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+	}
+
+	Jumpers.Add(Jumper);
+	Jumper->SetTraversalHandle(TraversalStore.Add(Jumper));
+	check(TraversalStore.Num() == Jumpers.Num());
+
+	// The character ticks first (probes, then events queued by its input), its movement last
+	BatchTickFunction.AddPrerequisite(Jumper, Jumper->PrimaryActorTick);
+	Jumper->GetCharacterMovement()->PrimaryComponentTick.AddPrerequisite(this, BatchTickFunction);
+	BatchTickFunction.SetTickFunctionEnable(true);
+}
+
+void UJumperStateMachineSubsystem::UnregisterJumper(AJumperCharacter* Jumper)
+{
+	const int32 Handle = Jumper->GetTraversalHandle();
+	if (Handle == INDEX_NONE)
+	{
+		return;
+	}
+
+	BatchTickFunction.RemovePrerequisite(Jumper, Jumper->PrimaryActorTick);
+	Jumper->GetCharacterMovement()->PrimaryComponentTick.RemovePrerequisite(this, BatchTickFunction);
+
+	Jumpers.RemoveAtSwap(Handle);
+	TraversalStore.RemoveSwap(Handle);
+	Jumper->SetTraversalHandle(INDEX_NONE);
+
+	if (Jumpers.Num() == 0)
+	{
+		BatchTickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UJumperStateMachineSubsystem::Deinitialize()
+{
+	if (BatchTickFunction.IsTickFunctionRegistered())
+	{
+		BatchTickFunction.UnRegisterTickFunction();
+	}
+	BatchTickFunction.Subsystem = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UJumperStateMachineSubsystem::Tick(float DeltaTime)
+{
+	UpdateSignificance();
+
+	if (IsBatchingEnabled())
+	{
+		TickBatches();
+	}
+}
+
+void UJumperStateMachineSubsystem::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_JumperSignificanceUpdate);
+
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if (!SignificanceManager)
+	{
+		return;
+	}
+
+	Viewpoints.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (const APlayerController* PlayerController = Iterator->Get())
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			Viewpoints.Emplace(Rotation, Location);
+		}
+	}
+
+	for (AJumperCharacter* Jumper : Jumpers)
+	{
+		Jumper->CacheSignificanceInputs();
+	}
+
+	SignificanceManager->Update(Viewpoints);
+}
+
+void UJumperStateMachineSubsystem::TickBatches()
+{
+	SCOPE_CYCLE_COUNTER(STAT_JumperBatchedStateMachineUpdate);
+
+	// Bucket by current state so each state's Update (and the code and data it touches) stays hot in cache
+	// while it runs over its whole batch
+	for (TArray<AJumperCharacter*>& Batch : Batches)
+	{
+		Batch.Reset();
+	}
+
+	// Characters on a reduced tick rate (see AJumperCharacter::ApplySignificance) only update on the frames they tick
+	for (AJumperCharacter* Jumper : Jumpers)
+	{
+		if (Jumper && !Jumper->IsPendingKill() && Jumper->HasTickedThisFrame())
+		{
+			Batches[static_cast<int32>(Jumper->CurrentState)].Add(Jumper);
+		}
+	}
+
+	if (CVarJumperTraversalStore.GetValueOnGameThread() != 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_JumperTraversalStorePredicates);
+
+		// Only the jumping state reads the predicates
+		const TArray<AJumperCharacter*>& PredicateBatch = Batches[static_cast<int32>(EState::VE_Jumping)];
+		TraversalStore.GatherMovement(PredicateBatch);
+		TraversalStore.EvaluatePredicates(PredicateBatch);
+	}
+
+	// Decide phase: states only read their character, so characters are independent and can decide in parallel
+	if (CVarJumperParallelDecide.GetValueOnGameThread() != 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_JumperBatchedStateMachineDecide);
+
+		for (const TArray<AJumperCharacter*>& Batch : Batches)
+		{
+			ParallelFor(Batch.Num(), [&Batch](int32 Index)
+			{
+				Batch[Index]->DecideStateMachineTick();
+			});
+		}
+	}
+
+	// Apply phase: side effects and transitions, serially on the game thread
+	for (const TArray<AJumperCharacter*>& Batch : Batches)
+	{
+		for (AJumperCharacter* Jumper : Batch)
+		{
+			Jumper->TickStateMachine();
+		}
+	}
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "States/StateEnum.h"
+#include "JumperTraversalStore.h"
+#include "JumperStateMachineSubsystem.generated.h"
+
+class AJumperCharacter;
+class AJumperTraversalIndex;
+class UJumperStateMachineSubsystem;
+
+/** Tick function of UJumperStateMachineSubsystem */
+struct FJumperBatchTickFunction : public FTickFunction
+{
+	UJumperStateMachineSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+/**
+ * Updates the state machines of all Jumpers in a world in one loop per frame, instead of from each
+ * character's own Tick. Characters are grouped by their current state before updating, so the same
+ * state's Update runs over a contiguous batch of characters. The read-only decide phase of the update
+ * (see BaseState::Decide) runs for all characters in parallel before the decisions are applied serially.
+ *
+ * It also updates the world's significance manager from the player viewpoints every frame.
+ *
+ * The batch ticks in TG_PrePhysics after the registered characters' actor ticks and before their movement
+ * components, so input dispatched to the states (e.g. the jump of IdleState) is applied by movement the same frame.
+ */
+UCLASS()
+class UJumperStateMachineSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns true if registered characters should leave their state machine update to the subsystem */
+	static bool IsBatchingEnabled();
+
+	void RegisterJumper(AJumperCharacter* Jumper);
+	void UnregisterJumper(AJumperCharacter* Jumper);
+
+	/** Packed traversal data of the registered characters, indexed by AJumperCharacter::GetTraversalHandle */
+	FJumperTraversalStore& GetTraversalStore() { return TraversalStore; }
+
+	/** Baked wall and ledge index of the world, registered by the index actor; null if the level has none */
+	const AJumperTraversalIndex* GetTraversalIndex() const { return TraversalIndex; }
+	void SetTraversalIndex(AJumperTraversalIndex* Index) { TraversalIndex = Index; }
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	/** Called by the tick function every frame while characters are registered */
+	void Tick(float DeltaTime);
+
+private:
+	/** Registered characters; a character's index is its traversal handle */
+	UPROPERTY(Transient)
+	TArray<AJumperCharacter*> Jumpers;
+
+	FJumperTraversalStore TraversalStore;
+
+	FJumperBatchTickFunction BatchTickFunction;
+
+	UPROPERTY(Transient)
+	AJumperTraversalIndex* TraversalIndex = nullptr;
+
+	/** Feeds the player viewpoints to the world's significance manager, which sets the Jumpers' update rates */
+	void UpdateSignificance();
+
+	/** Updates the state machines of the characters that ticked this frame, batched by state */
+	void TickBatches();
+
+	/** Registered characters bucketed by current state, rebuilt every frame */
+	TArray<AJumperCharacter*> Batches[static_cast<int32>(EState::VE_WallSliding) + 1];
+
+	TArray<FTransform> Viewpoints;
+};
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperTrace.h"
+#include "HAL/PlatformTime.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "Trace/Trace.h"
+
+// Trace channels were introduced in 4.25; on older engines the event is always emitted while tracing
+#define JUMPER_TRACE_HAS_CHANNELS (ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 25)
+
+#if UE_TRACE_ENABLED
+
+#if JUMPER_TRACE_HAS_CHANNELS
+UE_TRACE_CHANNEL(JumperChannel)
+#endif
+
+UE_TRACE_EVENT_BEGIN(Jumper, StateTransition)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, CharacterId)
+	UE_TRACE_EVENT_FIELD(uint8, FromState)
+	UE_TRACE_EVENT_FIELD(uint8, ToState)
+	UE_TRACE_EVENT_FIELD(uint8, Depth)
+UE_TRACE_EVENT_END()
+
+#endif // UE_TRACE_ENABLED
+
+void TraceJumperStateTransition(uint32 CharacterId, uint8 FromState, uint8 ToState, uint8 Depth)
+{
+#if UE_TRACE_ENABLED
+#if JUMPER_TRACE_HAS_CHANNELS
+	UE_TRACE_LOG(Jumper, StateTransition, JumperChannel)
+#else
+	UE_TRACE_LOG(Jumper, StateTransition)
+#endif
+		<< StateTransition.Cycle(FPlatformTime::Cycles64())
+		<< StateTransition.CharacterId(CharacterId)
+		<< StateTransition.FromState(FromState)
+		<< StateTransition.ToState(ToState)
+		<< StateTransition.Depth(Depth);
+#endif
+}
@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** State id sent for the source of a transition that didn't replace a state */
+constexpr uint8 JumperTraceNoState = MAX_uint8;
+
+/** Emits a Jumper.StateTransition event to Unreal Insights; states are EState values or JumperTraceNoState */
+void TraceJumperStateTransition(uint32 CharacterId, uint8 FromState, uint8 ToState, uint8 Depth);
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperTransitionRecorder.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Jumper.h"
+#include "JumperTrace.h"
+#include "States/StateEnum.h"
+
+static FAutoConsoleCommand DumpJumperTransitionsCommand(
+	TEXT("Jumper.StateMachine.DumpTransitions"),
+	TEXT("Logs the most recent Jumper state machine transitions. Optional argument: maximum number of transitions to log."),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const uint32 MaxRecords = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 0) : FJumperTransitionRecorder::Capacity;
+		FJumperTransitionRecorder::Get().Dump(MaxRecords);
+	}));
+
+static FString GetRecordedStateName(uint8 State)
+{
+	return State == JumperTraceNoState ? FString(TEXT("None")) : StaticEnum<EState>()->GetNameStringByValue(State);
+}
+
+constexpr uint32 FJumperTransitionRecorder::Capacity;
+
+FJumperTransitionRecorder& FJumperTransitionRecorder::Get()
+{
+	static FJumperTransitionRecorder Recorder;
+	return Recorder;
+}
+
+void FJumperTransitionRecorder::Record(uint32 CharacterId, uint8 FromState, uint8 ToState, uint8 Depth)
+{
+	const uint64 Index = NextIndex++;
+	FSlot& Slot = Slots[Index % Capacity];
+
+	Slot.Sequence = 0;
+	Slot.Record.Cycle = FPlatformTime::Cycles64();
+	Slot.Record.Frame = GFrameCounter;
+	Slot.Record.CharacterId = CharacterId;
+	Slot.Record.FromState = FromState;
+	Slot.Record.ToState = ToState;
+	Slot.Record.Depth = Depth;
+	Slot.Sequence = Index + 1;
+}
+
+void FJumperTransitionRecorder::GetRecentRecords(TArray<FJumperTransitionRecord>& OutRecords, uint32 MaxRecords) const
+{
+	const uint64 EndIndex = NextIndex;
+	const uint64 NumRecords = FMath::Min<uint64>(EndIndex, FMath::Min(MaxRecords, Capacity));
+
+	OutRecords.Reset(static_cast<int32>(NumRecords));
+	for (uint64 Index = EndIndex - NumRecords; Index < EndIndex; ++Index)
+	{
+		const FSlot& Slot = Slots[Index % Capacity];
+		if (Slot.Sequence != Index + 1)
+		{
+			continue;
+		}
+
+		const FJumperTransitionRecord Record = Slot.Record;
+
+		// A writer may have claimed the slot while we were copying it
+		if (Slot.Sequence == Index + 1)
+		{
+			OutRecords.Add(Record);
+		}
+	}
+}
+
+void FJumperTransitionRecorder::Dump(uint32 MaxRecords) const
+{
+	TArray<FJumperTransitionRecord> Records;
+	GetRecentRecords(Records, MaxRecords);
+
+	UE_LOG(LogJumperHSM, Display, TEXT("Last %d Jumper state transitions:"), Records.Num());
+	for (const FJumperTransitionRecord& Record : Records)
+	{
+		UE_LOG(LogJumperHSM, Display, TEXT("  [%.3f ms, frame %llu] Jumper %u: %s -> %s (depth %u)"),
+			FPlatformTime::ToMilliseconds64(Record.Cycle), Record.Frame, Record.CharacterId,
+			*GetRecordedStateName(Record.FromState), *GetRecordedStateName(Record.ToState), Record.Depth);
+	}
+}
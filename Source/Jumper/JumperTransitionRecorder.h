@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+/** A state machine transition, as captured by FJumperTransitionRecorder */
+struct FJumperTransitionRecord
+{
+	uint64 Cycle;
+	uint64 Frame;
+	uint32 CharacterId;
+	uint8 FromState;	// EState, or JumperTraceNoState if the transition didn't replace a state
+	uint8 ToState;
+	uint8 Depth;
+};
+
+/**
+ * Fixed-size ring buffer of the most recent state machine transitions of all Jumpers. Recording is lock-free and
+ * never allocates or formats strings, so it can stay on in busy scenes; the buffer is only turned into log output
+ * when dumped with the Jumper.StateMachine.DumpTransitions console command.
+ */
+class FJumperTransitionRecorder
+{
+public:
+	static constexpr uint32 Capacity = 4096;
+
+	static FJumperTransitionRecorder& Get();
+
+	void Record(uint32 CharacterId, uint8 FromState, uint8 ToState, uint8 Depth);
+
+	/** Copies up to MaxRecords of the most recent records, oldest first. Records being overwritten are skipped. */
+	void GetRecentRecords(TArray<FJumperTransitionRecord>& OutRecords, uint32 MaxRecords = Capacity) const;
+
+	/** Writes the most recent records to LogJumperHSM */
+	void Dump(uint32 MaxRecords = Capacity) const;
+
+private:
+	struct FSlot
+	{
+		/** Index + 1 of the record in the slot once it is fully written, 0 while it is being written */
+		TAtomic<uint64> Sequence;
+		FJumperTransitionRecord Record;
+	};
+
+	FSlot Slots[Capacity];
+
+	/** Total number of records ever started; the next record goes to slot NextIndex % Capacity */
+	TAtomic<uint64> NextIndex;
+};
@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperTraversalIndex.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Jumper.h"
+#include "JumperStateMachineSubsystem.h"
+#include "PhysicsEngine/BodySetup.h"
+
+DECLARE_CYCLE_STAT(TEXT("Traversal Index Trace"), STAT_JumperTraversalIndexTrace, STATGROUP_Jumper);
+
+// Upper bound on the number of grid cells; larger levels get coarser cells
+static const int32 MaxGridCells = 1 << 22;
+
+AJumperTraversalIndex::AJumperTraversalIndex()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+	RootComponent->SetMobility(EComponentMobility::Static);
+
+	// The channels of the wall and ledge probes (see AJumperCharacter)
+	TraceChannels = { ECC_Visibility, ECC_GameTraceChannel3 };
+}
+
+void AJumperTraversalIndex::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UJumperStateMachineSubsystem* StateMachineSubsystem = GetWorld()->GetSubsystem<UJumperStateMachineSubsystem>())
+	{
+		StateMachineSubsystem->SetTraversalIndex(this);
+	}
+}
+
+void AJumperTraversalIndex::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UJumperStateMachineSubsystem* StateMachineSubsystem = GetWorld()->GetSubsystem<UJumperStateMachineSubsystem>())
+	{
+		if (StateMachineSubsystem->GetTraversalIndex() == this)
+		{
+			StateMachineSubsystem->SetTraversalIndex(nullptr);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AJumperTraversalIndex::Bake()
+{
+	Modify();
+
+	Faces.Reset();
+	UnbakedBounds.Reset();
+
+	// Sublevels are streamed in around the persistent level, and the one index covers all of them
+	int32 NumLevels = 0;
+	for (const ULevel* Level : GetWorld()->GetLevels())
+	{
+		++NumLevels;
+		for (AActor* Actor : Level->Actors)
+		{
+			if (!Actor || Actor == this)
+			{
+				continue;
+			}
+
+			BakeActor(*Actor);
+		}
+	}
+
+	BuildGrid();
+
+	UE_LOG(LogJumperHSM, Display, TEXT("%s: baked %d traversal faces from %d levels into a %dx%d grid of %.0f unit cells, skipped %d components"),
+		*GetName(), Faces.Num(), NumLevels, GridSize.X, GridSize.Y, GridCellSize, UnbakedBounds.Num());
+}
+
+void AJumperTraversalIndex::BakeActor(const AActor& Actor)
+{
+	TInlineComponentArray<UPrimitiveComponent*> Components(&Actor);
+	for (const UPrimitiveComponent* Component : Components)
+	{
+		// Movable geometry is swept for at runtime, whether it is baked or not
+		if (Component->Mobility == EComponentMobility::Movable || !Component->IsCollisionEnabled())
+		{
+			continue;
+		}
+
+		int32 NumBlockedChannels = 0;
+		for (const ECollisionChannel Channel : TraceChannels)
+		{
+			NumBlockedChannels += Component->GetCollisionResponseToChannel(Channel) == ECR_Block ? 1 : 0;
+		}
+		if (NumBlockedChannels == 0)
+		{
+			continue;
+		}
+
+		// Only exact box collision is baked; everything else makes the probes near it trace
+		const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Component);
+		const UBodySetup* BodySetup = MeshComponent && MeshComponent->GetStaticMesh() ? MeshComponent->GetBodySetup() : nullptr;
+		const TCHAR* SkipReason = !BodySetup ? TEXT("not a static mesh")
+			: Component->Mobility != EComponentMobility::Static ? TEXT("not static")
+			: NumBlockedChannels != TraceChannels.Num() ? TEXT("doesn't block all trace channels")
+			: BodySetup->CollisionTraceFlag == CTF_UseComplexAsSimple ? TEXT("uses complex collision")
+			: BodySetup->AggGeom.BoxElems.Num() == 0 ? TEXT("has no box collision")
+			: BodySetup->AggGeom.GetElementCount() != BodySetup->AggGeom.BoxElems.Num() ? TEXT("has collision other than boxes")
+			: nullptr;
+
+		if (SkipReason)
+		{
+			UE_LOG(LogJumperHSM, Log, TEXT("%s: not baking %s (%s), probes near it are traced"), *GetName(), *Component->GetPathName(), SkipReason);
+			UnbakedBounds.Add(Component->Bounds.GetBox());
+			continue;
+		}
+
+		const FTransform& ComponentToWorld = MeshComponent->GetComponentTransform();
+		for (const FKBoxElem& Box : BodySetup->AggGeom.BoxElems)
+		{
+			AddBoxFaces(Box.GetTransform() * ComponentToWorld, FVector(Box.X, Box.Y, Box.Z) * 0.5f);
+		}
+	}
+}
+
+void AJumperTraversalIndex::AddBoxFaces(const FTransform& BoxToWorld, const FVector& HalfExtent)
+{
+	const FVector Center = BoxToWorld.GetLocation();
+	const FVector Scale = BoxToWorld.GetScale3D().GetAbs();
+
+	const FVector Axes[3] = { BoxToWorld.GetUnitAxis(EAxis::X), BoxToWorld.GetUnitAxis(EAxis::Y), BoxToWorld.GetUnitAxis(EAxis::Z) };
+	const float Halves[3] = { HalfExtent.X * Scale.X, HalfExtent.Y * Scale.Y, HalfExtent.Z * Scale.Z };
+
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		for (const float Sign : { 1.0f, -1.0f })
+		{
+			const FVector Normal = Axes[Axis] * Sign;
+
+			FJumperTraversalFace& Face = Faces.AddDefaulted_GetRef();
+			Face.Center = Center + Normal * Halves[Axis];
+			Face.Normal = Normal;
+			Face.AxisU = Axes[(Axis + 1) % 3];
+			Face.AxisV = Axes[(Axis + 2) % 3];
+			Face.HalfU = Halves[(Axis + 1) % 3];
+			Face.HalfV = Halves[(Axis + 2) % 3];
+		}
+	}
+}
+
+void AJumperTraversalIndex::BuildGrid()
+{
+	CellStart.Reset();
+	CellFaces.Reset();
+	UnbakedCellStart.Reset();
+	UnbakedCells.Reset();
+	GridOrigin = FIntPoint::ZeroValue;
+	GridSize = FIntPoint::ZeroValue;
+
+	if (Faces.Num() == 0 && UnbakedBounds.Num() == 0)
+	{
+		return;
+	}
+
+	// XY bounds of each face
+	TArray<FBox2D> FaceBounds;
+	FaceBounds.Reserve(Faces.Num());
+	FBox2D Bounds(ForceInit);
+	for (const FJumperTraversalFace& Face : Faces)
+	{
+		const FVector U = Face.AxisU * Face.HalfU;
+		const FVector V = Face.AxisV * Face.HalfV;
+		const FVector2D Extent(FMath::Abs(U.X) + FMath::Abs(V.X), FMath::Abs(U.Y) + FMath::Abs(V.Y));
+		const FVector2D Center(Face.Center);
+		FaceBounds.Emplace(Center - Extent, Center + Extent);
+		Bounds += FaceBounds.Last();
+	}
+
+	TArray<FBox2D> UnbakedBounds2D;
+	UnbakedBounds2D.Reserve(UnbakedBounds.Num());
+	for (const FBox& Box : UnbakedBounds)
+	{
+		UnbakedBounds2D.Emplace(FVector2D(Box.Min), FVector2D(Box.Max));
+		Bounds += UnbakedBounds2D.Last();
+	}
+
+	GridCellSize = CellSize;
+	const FVector2D BoundsSize = Bounds.GetSize();
+	while ((BoundsSize.X / GridCellSize + 1.0f) * (BoundsSize.Y / GridCellSize + 1.0f) > MaxGridCells)
+	{
+		GridCellSize *= 2.0f;
+	}
+
+	GridOrigin = FIntPoint(FMath::FloorToInt(Bounds.Min.X / GridCellSize), FMath::FloorToInt(Bounds.Min.Y / GridCellSize));
+	GridSize = FIntPoint(FMath::FloorToInt(Bounds.Max.X / GridCellSize), FMath::FloorToInt(Bounds.Max.Y / GridCellSize)) - GridOrigin + FIntPoint(1, 1);
+
+	FillCells(FaceBounds, CellStart, CellFaces);
+	FillCells(UnbakedBounds2D, UnbakedCellStart, UnbakedCells);
+}
+
+void AJumperTraversalIndex::FillCells(const TArray<FBox2D>& ItemBounds, TArray<int32>& OutCellStart, TArray<int32>& OutCellItems) const
+{
+	// Count the items in each cell, turn the counts into start offsets, then fill
+	const int32 NumCells = GridSize.X * GridSize.Y;
+	OutCellStart.SetNumZeroed(NumCells + 1);
+
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		TArray<int32> CellFill;
+		if (Pass == 1)
+		{
+			for (int32 Cell = 0; Cell < NumCells; ++Cell)
+			{
+				OutCellStart[Cell + 1] += OutCellStart[Cell];
+			}
+			OutCellItems.SetNumUninitialized(OutCellStart[NumCells]);
+			CellFill = OutCellStart;
+		}
+
+		for (int32 ItemIndex = 0; ItemIndex < ItemBounds.Num(); ++ItemIndex)
+		{
+			const FIntPoint Min = GetCell(FVector(ItemBounds[ItemIndex].Min, 0.0f));
+			const FIntPoint Max = GetCell(FVector(ItemBounds[ItemIndex].Max, 0.0f));
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			{
+				for (int32 X = Min.X; X <= Max.X; ++X)
+				{
+					const int32 Cell = (Y - GridOrigin.Y) * GridSize.X + (X - GridOrigin.X);
+					if (Pass == 0)
+					{
+						++OutCellStart[Cell + 1];
+					}
+					else
+					{
+						OutCellItems[CellFill[Cell]++] = ItemIndex;
+					}
+				}
+			}
+		}
+	}
+}
+
+FIntPoint AJumperTraversalIndex::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / GridCellSize), FMath::FloorToInt(Location.Y / GridCellSize));
+}
+
+bool AJumperTraversalIndex::ClampCellRange(FIntPoint& InOutMin, FIntPoint& InOutMax) const
+{
+	const FIntPoint GridMax = GridOrigin + GridSize - FIntPoint(1, 1);
+	if (GridSize.X <= 0 || InOutMax.X < GridOrigin.X || InOutMax.Y < GridOrigin.Y || InOutMin.X > GridMax.X || InOutMin.Y > GridMax.Y)
+	{
+		return false;
+	}
+
+	InOutMin = FIntPoint(FMath::Max(InOutMin.X, GridOrigin.X), FMath::Max(InOutMin.Y, GridOrigin.Y));
+	InOutMax = FIntPoint(FMath::Min(InOutMax.X, GridMax.X), FMath::Min(InOutMax.Y, GridMax.Y));
+	return true;
+}
+
+bool AJumperTraversalIndex::CanSweep(ECollisionChannel Channel, const FVector& Start, const FVector& End, float Radius) const
+{
+	if (!TraceChannels.Contains(Channel))
+	{
+		return false;
+	}
+
+	const FBox SweepBounds(Start.ComponentMin(End) - FVector(Radius), Start.ComponentMax(End) + FVector(Radius));
+
+	FIntPoint CellMin = GetCell(SweepBounds.Min);
+	FIntPoint CellMax = GetCell(SweepBounds.Max);
+	if (!ClampCellRange(CellMin, CellMax))
+	{
+		// Outside the grid is whatever wasn't loaded when the index was baked, so it is left to the trace
+		return false;
+	}
+
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			const int32 Cell = (Y - GridOrigin.Y) * GridSize.X + (X - GridOrigin.X);
+			for (int32 Entry = UnbakedCellStart[Cell]; Entry < UnbakedCellStart[Cell + 1]; ++Entry)
+			{
+				if (UnbakedBounds[UnbakedCells[Entry]].Intersect(SweepBounds))
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool AJumperTraversalIndex::Sweep(const FVector& Start, const FVector& End, float Radius, FHitResult& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_JumperTraversalIndexTrace);
+
+	FIntPoint CellMin = GetCell(Start.ComponentMin(End) - FVector(Radius));
+	FIntPoint CellMax = GetCell(Start.ComponentMax(End) + FVector(Radius));
+	if (!ClampCellRange(CellMin, CellMax))
+	{
+		return false;
+	}
+
+	// Probe traces are short, so they only ever cover a few cells; a face in several of them is simply tested again
+	const FVector Direction = End - Start;
+	float BestTime = 1.0f;
+	const FJumperTraversalFace* BestFace = nullptr;
+
+	for (int32 Y = CellMin.Y; Y <= CellMax.Y; ++Y)
+	{
+		for (int32 X = CellMin.X; X <= CellMax.X; ++X)
+		{
+			const int32 Cell = (Y - GridOrigin.Y) * GridSize.X + (X - GridOrigin.X);
+			for (int32 Entry = CellStart[Cell]; Entry < CellStart[Cell + 1]; ++Entry)
+			{
+				const FJumperTraversalFace& Face = Faces[CellFaces[Entry]];
+
+				// One-sided: the segment must travel against the face normal
+				const float Approach = Direction | Face.Normal;
+				if (Approach >= 0.0f)
+				{
+					continue;
+				}
+
+				// The sphere center touches the face when it reaches the face plane pushed out by Radius
+				const float Time = (((Face.Center - Start) | Face.Normal) + Radius) / Approach;
+				if (Time < 0.0f || Time > BestTime)
+				{
+					continue;
+				}
+
+				const FVector FromCenter = Start + Direction * Time - Face.Center;
+				if (FMath::Abs(FromCenter | Face.AxisU) <= Face.HalfU + Radius && FMath::Abs(FromCenter | Face.AxisV) <= Face.HalfV + Radius)
+				{
+					BestTime = Time;
+					BestFace = &Face;
+				}
+			}
+		}
+	}
+
+	if (!BestFace)
+	{
+		return false;
+	}
+
+	const FVector Impact = Start + Direction * BestTime - BestFace->Normal * Radius;
+	OutHit = FHitResult(this, nullptr, Impact, BestFace->Normal);
+	OutHit.Location = Start + Direction * BestTime;
+	OutHit.bBlockingHit = true;
+	OutHit.Time = BestTime;
+	OutHit.Distance = Direction.Size() * BestTime;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	return true;
+}
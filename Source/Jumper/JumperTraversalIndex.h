@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "JumperTraversalIndex.generated.h"
+
+/** One-sided rectangle baked from a box face: a wall-slide surface when vertical, a ledge or floor top when facing up */
+USTRUCT()
+struct FJumperTraversalFace
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Center = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector Normal = FVector::UpVector;
+
+	/** Unit axes spanning the face, with the half extent along each */
+	UPROPERTY()
+	FVector AxisU = FVector::ForwardVector;
+
+	UPROPERTY()
+	FVector AxisV = FVector::RightVector;
+
+	UPROPERTY()
+	float HalfU = 0.0f;
+
+	UPROPERTY()
+	float HalfV = 0.0f;
+};
+
+/**
+ * Grid index of the wall and ledge surfaces of a map's static geometry, baked from the box collision of static
+ * meshes that block the trace channels and saved with the map. It covers the persistent level and every sublevel
+ * loaded when it was baked; probes outside its grid are traced as usual. While one is in the world, Jumpers answer their wall
+ * and ledge probes from it instead of tracing against the static physics scene. Geometry it can't represent exactly
+ * (stationary components, meshes with collision other than boxes, and anything that isn't a static mesh) is only
+ * baked as bounds, and probes overlapping those are traced as usual; movable geometry is always traced for.
+ *
+ * Bake it with the Bake button in its details panel, or for whole maps with the JumperBakeTraversal commandlet.
+ * It must be rebaked whenever the level's static geometry changes.
+ */
+UCLASS(hidecategories = (Input, Rendering, Collision, Replication, LOD, Cooking, Actor))
+class AJumperTraversalIndex : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AJumperTraversalIndex();
+
+	/** Rebuilds the index from the static meshes in all of the world's loaded levels */
+	UFUNCTION(CallInEditor, Category = "Traversal Index")
+	void Bake();
+
+	/**
+	 * Returns true if the index holds all the non-movable geometry a sphere of Radius swept along the segment on
+	 * Channel can hit, i.e. Channel is baked and the sweep stays inside the grid and clear of the bounds of unbaked
+	 * geometry
+	 */
+	bool CanSweep(ECollisionChannel Channel, const FVector& Start, const FVector& End, float Radius) const;
+
+	/**
+	 * Finds the nearest face a sphere of Radius (0 for a line trace) swept along the segment hits from its front side.
+	 * Fills the hit's impact point, normal and time. Faces are tested as rectangles grown by Radius on each side, so
+	 * near an edge the sphere may report a hit a little before its rounded shape would touch the face.
+	 */
+	bool Sweep(const FVector& Start, const FVector& End, float Radius, FHitResult& OutHit) const;
+
+	int32 GetNumFaces() const { return Faces.Num(); }
+
+	/** Channels the index answers probes on; components are only baked if they block all of them */
+	UPROPERTY(EditAnywhere, Category = "Traversal Index")
+	TArray<TEnumAsByte<ECollisionChannel>> TraceChannels;
+
+	/** Size of the grid cells in the XY plane */
+	UPROPERTY(EditAnywhere, Category = "Traversal Index", meta = (ClampMin = "50.0"))
+	float CellSize = 400.0f;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Adds the six faces of a box; all of them, as a probe trace would hit sloped and downward faces too */
+	void AddBoxFaces(const FTransform& BoxToWorld, const FVector& HalfExtent);
+
+	/** Adds the faces of the actor's baked components, or their bounds to UnbakedBounds */
+	void BakeActor(const AActor& Actor);
+
+	void BuildGrid();
+
+	/** Fills a compressed-row cell list (see CellStart) with the items whose XY bounds overlap each cell */
+	void FillCells(const TArray<FBox2D>& ItemBounds, TArray<int32>& OutCellStart, TArray<int32>& OutCellItems) const;
+
+	/** Returns false if the cell range doesn't overlap the grid; otherwise clamps it to the grid */
+	bool ClampCellRange(FIntPoint& InOutMin, FIntPoint& InOutMax) const;
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	UPROPERTY()
+	TArray<FJumperTraversalFace> Faces;
+
+	/** Cell grid covering the faces, in compressed rows: the faces of cell C are CellFaces[CellStart[C] .. CellStart[C + 1]) */
+	UPROPERTY()
+	FIntPoint GridOrigin = FIntPoint::ZeroValue;
+
+	UPROPERTY()
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	UPROPERTY()
+	float GridCellSize = 400.0f;
+
+	UPROPERTY()
+	TArray<int32> CellStart;
+
+	UPROPERTY()
+	TArray<int32> CellFaces;
+
+	/** Bounds of the non-movable geometry that blocks a trace channel but wasn't baked into faces */
+	UPROPERTY()
+	TArray<FBox> UnbakedBounds;
+
+	/** Same grid as CellStart and CellFaces, listing UnbakedBounds */
+	UPROPERTY()
+	TArray<int32> UnbakedCellStart;
+
+	UPROPERTY()
+	TArray<int32> UnbakedCells;
+};
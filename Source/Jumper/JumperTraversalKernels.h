@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Batch evaluation of the Jumper traversal predicates over structure-of-arrays data (see FJumperTraversalStore).
+// Engine-agnostic so it can be benchmarked outside Unreal (Benchmarks/Hsm). The AVX2 kernel is compiled in on
+// x86-64 with GCC, Clang and MSVC and selected at runtime when the CPU supports it; SSE2 is the x86-64 baseline,
+// and other platforms use the scalar kernel.
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JUMPER_TRAVERSAL_KERNELS_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define JUMPER_TRAVERSAL_TARGET_AVX2
+#else
+#define JUMPER_TRAVERSAL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define JUMPER_TRAVERSAL_KERNELS_X64 0
+#endif
+
+namespace JumperTraversalKernels
+{
+	// Input flag bits; match EJumperTraversalFlags
+	enum : uint8_t
+	{
+		FlagNearFloor	= 1 << 0,
+		FlagNearWall	= 1 << 1,
+		FlagNearLedge	= 1 << 2,
+		FlagFalling		= 1 << 3,
+	};
+
+	// Output mask bits; match EJumperTraversalPredicates
+	enum : uint8_t
+	{
+		PredicateCanGrabLedge	= 1 << 0,
+		PredicateCanWallSlide	= 1 << 1,
+	};
+
+	struct FInput
+	{
+		const float* LocationX;
+		const float* LocationY;
+		const float* LocationZ;
+		const float* VelocityZ;
+		const float* WallImpactX;
+		const float* WallImpactY;
+		const float* WallImpactZ;
+		const uint8_t* Flags;
+		int32_t Num;
+
+		float WallSlideDistanceSquared;	// Wall slide needs the wall impact point closer than this
+		float MaxWallSlideVelocityZ;	// and a vertical velocity below this
+	};
+
+	// For each character i writes OutMasks[i] = its predicate bits | ExtraBits:
+	//   CanGrabLedge: !NearFloor && NearLedge && Falling
+	//   CanWallSlide: !NearFloor && NearWall && |Location - WallImpact|^2 < WallSlideDistanceSquared && VelocityZ < MaxWallSlideVelocityZ
+	inline void EvaluatePredicatesScalar(const FInput& In, uint8_t* OutMasks, uint8_t ExtraBits, int32_t Begin = 0)
+	{
+		for (int32_t i = Begin; i < In.Num; ++i)
+		{
+			const uint8_t Flags = In.Flags[i];
+
+			const float DX = In.LocationX[i] - In.WallImpactX[i];
+			const float DY = In.LocationY[i] - In.WallImpactY[i];
+			const float DZ = In.LocationZ[i] - In.WallImpactZ[i];
+			const float DistanceSquared = DX * DX + DY * DY + DZ * DZ;
+
+			const bool bCanGrabLedge = (Flags & (FlagNearFloor | FlagNearLedge | FlagFalling)) == (FlagNearLedge | FlagFalling);
+			const bool bCanWallSlide = (Flags & (FlagNearFloor | FlagNearWall)) == FlagNearWall
+				&& DistanceSquared < In.WallSlideDistanceSquared && In.VelocityZ[i] < In.MaxWallSlideVelocityZ;
+
+			OutMasks[i] = static_cast<uint8_t>((bCanGrabLedge ? PredicateCanGrabLedge : 0) | (bCanWallSlide ? PredicateCanWallSlide : 0) | ExtraBits);
+		}
+	}
+
+#if JUMPER_TRAVERSAL_KERNELS_X64
+
+	// 8 characters per iteration as two 4-wide halves
+	inline void EvaluatePredicatesSSE2(const FInput& In, uint8_t* OutMasks, uint8_t ExtraBits)
+	{
+		const __m128 MaxDistanceSquared = _mm_set1_ps(In.WallSlideDistanceSquared);
+		const __m128 MaxVelocityZ = _mm_set1_ps(In.MaxWallSlideVelocityZ);
+		const __m128i LedgeTest = _mm_set1_epi32(FlagNearFloor | FlagNearLedge | FlagFalling);
+		const __m128i LedgeExpected = _mm_set1_epi32(FlagNearLedge | FlagFalling);
+		const __m128i WallTest = _mm_set1_epi32(FlagNearFloor | FlagNearWall);
+		const __m128i WallExpected = _mm_set1_epi32(FlagNearWall);
+		const __m128i LedgeBit = _mm_set1_epi32(PredicateCanGrabLedge);
+		const __m128i WallBit = _mm_set1_epi32(PredicateCanWallSlide);
+		const __m128i Extra = _mm_set1_epi32(ExtraBits);
+		const __m128i Zero = _mm_setzero_si128();
+
+		int32_t i = 0;
+		for (; i + 8 <= In.Num; i += 8)
+		{
+			// Widen 8 flag bytes to two vectors of 4 ints
+			const __m128i Flags8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(In.Flags + i));
+			const __m128i Flags16 = _mm_unpacklo_epi8(Flags8, Zero);
+			const __m128i FlagsHalves[2] = { _mm_unpacklo_epi16(Flags16, Zero), _mm_unpackhi_epi16(Flags16, Zero) };
+
+			__m128i Masks[2];
+			for (int32_t Half = 0; Half < 2; ++Half)
+			{
+				const int32_t j = i + Half * 4;
+				const __m128 DX = _mm_sub_ps(_mm_loadu_ps(In.LocationX + j), _mm_loadu_ps(In.WallImpactX + j));
+				const __m128 DY = _mm_sub_ps(_mm_loadu_ps(In.LocationY + j), _mm_loadu_ps(In.WallImpactY + j));
+				const __m128 DZ = _mm_sub_ps(_mm_loadu_ps(In.LocationZ + j), _mm_loadu_ps(In.WallImpactZ + j));
+				const __m128 DistanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+
+				const __m128 bCloseAndSliding = _mm_and_ps(_mm_cmplt_ps(DistanceSquared, MaxDistanceSquared),
+					_mm_cmplt_ps(_mm_loadu_ps(In.VelocityZ + j), MaxVelocityZ));
+
+				const __m128i Flags = FlagsHalves[Half];
+				const __m128i bCanGrabLedge = _mm_cmpeq_epi32(_mm_and_si128(Flags, LedgeTest), LedgeExpected);
+				const __m128i bCanWallSlide = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(Flags, WallTest), WallExpected), _mm_castps_si128(bCloseAndSliding));
+
+				Masks[Half] = _mm_or_si128(_mm_or_si128(_mm_and_si128(bCanGrabLedge, LedgeBit), _mm_and_si128(bCanWallSlide, WallBit)), Extra);
+			}
+
+			// Narrow back to 8 bytes; every value fits in a byte so the saturating packs don't change it
+			const __m128i Masks16 = _mm_packs_epi32(Masks[0], Masks[1]);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(OutMasks + i), _mm_packus_epi16(Masks16, Masks16));
+		}
+
+		EvaluatePredicatesScalar(In, OutMasks, ExtraBits, i);
+	}
+
+	// 8 characters per iteration in one 8-wide vector
+	JUMPER_TRAVERSAL_TARGET_AVX2 inline void EvaluatePredicatesAVX2(const FInput& In, uint8_t* OutMasks, uint8_t ExtraBits)
+	{
+		const __m256 MaxDistanceSquared = _mm256_set1_ps(In.WallSlideDistanceSquared);
+		const __m256 MaxVelocityZ = _mm256_set1_ps(In.MaxWallSlideVelocityZ);
+		const __m256i LedgeTest = _mm256_set1_epi32(FlagNearFloor | FlagNearLedge | FlagFalling);
+		const __m256i LedgeExpected = _mm256_set1_epi32(FlagNearLedge | FlagFalling);
+		const __m256i WallTest = _mm256_set1_epi32(FlagNearFloor | FlagNearWall);
+		const __m256i WallExpected = _mm256_set1_epi32(FlagNearWall);
+		const __m256i LedgeBit = _mm256_set1_epi32(PredicateCanGrabLedge);
+		const __m256i WallBit = _mm256_set1_epi32(PredicateCanWallSlide);
+		const __m256i Extra = _mm256_set1_epi32(ExtraBits);
+
+		int32_t i = 0;
+		for (; i + 8 <= In.Num; i += 8)
+		{
+			const __m256 DX = _mm256_sub_ps(_mm256_loadu_ps(In.LocationX + i), _mm256_loadu_ps(In.WallImpactX + i));
+			const __m256 DY = _mm256_sub_ps(_mm256_loadu_ps(In.LocationY + i), _mm256_loadu_ps(In.WallImpactY + i));
+			const __m256 DZ = _mm256_sub_ps(_mm256_loadu_ps(In.LocationZ + i), _mm256_loadu_ps(In.WallImpactZ + i));
+			const __m256 DistanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(DX, DX), _mm256_mul_ps(DY, DY)), _mm256_mul_ps(DZ, DZ));
+
+			const __m256 bCloseAndSliding = _mm256_and_ps(_mm256_cmp_ps(DistanceSquared, MaxDistanceSquared, _CMP_LT_OQ),
+				_mm256_cmp_ps(_mm256_loadu_ps(In.VelocityZ + i), MaxVelocityZ, _CMP_LT_OQ));
+
+			const __m256i Flags = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(In.Flags + i)));
+			const __m256i bCanGrabLedge = _mm256_cmpeq_epi32(_mm256_and_si256(Flags, LedgeTest), LedgeExpected);
+			const __m256i bCanWallSlide = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(Flags, WallTest), WallExpected), _mm256_castps_si256(bCloseAndSliding));
+
+			const __m256i Masks = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(bCanGrabLedge, LedgeBit), _mm256_and_si256(bCanWallSlide, WallBit)), Extra);
+
+			// Narrow 8 ints to 8 bytes
+			const __m128i Masks16 = _mm_packs_epi32(_mm256_castsi256_si128(Masks), _mm256_extracti128_si256(Masks, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(OutMasks + i), _mm_packus_epi16(Masks16, Masks16));
+		}
+
+		EvaluatePredicatesScalar(In, OutMasks, ExtraBits, i);
+	}
+
+	inline bool IsAVX2Supported()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		static const bool bSupported = []()
+		{
+			int CpuInfo[4];
+			__cpuid(CpuInfo, 0);
+			if (CpuInfo[0] < 7)
+			{
+				return false;
+			}
+			__cpuid(CpuInfo, 1);
+			const bool bOSXSave = (CpuInfo[2] & (1 << 27)) != 0;
+			const bool bAVX = (CpuInfo[2] & (1 << 28)) != 0;
+			if (!bOSXSave || !bAVX || (_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+			__cpuidex(CpuInfo, 7, 0);
+			return (CpuInfo[1] & (1 << 5)) != 0;
+		}();
+		return bSupported;
+#else
+		static const bool bSupported = __builtin_cpu_supports("avx2") != 0;
+		return bSupported;
+#endif
+	}
+
+#endif // JUMPER_TRAVERSAL_KERNELS_X64
+
+	// Evaluates with the widest kernel the CPU supports
+	inline void EvaluatePredicates(const FInput& In, uint8_t* OutMasks, uint8_t ExtraBits)
+	{
+#if JUMPER_TRAVERSAL_KERNELS_X64
+		if (IsAVX2Supported())
+		{
+			EvaluatePredicatesAVX2(In, OutMasks, ExtraBits);
+		}
+		else
+		{
+			EvaluatePredicatesSSE2(In, OutMasks, ExtraBits);
+		}
+#else
+		EvaluatePredicatesScalar(In, OutMasks, ExtraBits);
+#endif
+	}
+}
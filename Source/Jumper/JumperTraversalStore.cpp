@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JumperTraversalStore.h"
+#include "JumperCharacter.h"
+#include "JumperTraversalKernels.h"
+
+static_assert(static_cast<uint8>(EJumperTraversalFlags::NearFloor) == JumperTraversalKernels::FlagNearFloor
+	&& static_cast<uint8>(EJumperTraversalFlags::NearWall) == JumperTraversalKernels::FlagNearWall
+	&& static_cast<uint8>(EJumperTraversalFlags::NearLedge) == JumperTraversalKernels::FlagNearLedge
+	&& static_cast<uint8>(EJumperTraversalFlags::Falling) == JumperTraversalKernels::FlagFalling,
+	"EJumperTraversalFlags must match the traversal kernel flags");
+static_assert(static_cast<uint8>(EJumperTraversalPredicates::CanGrabLedge) == JumperTraversalKernels::PredicateCanGrabLedge
+	&& static_cast<uint8>(EJumperTraversalPredicates::CanWallSlide) == JumperTraversalKernels::PredicateCanWallSlide,
+	"EJumperTraversalPredicates must match the traversal kernel predicates");
+
+constexpr float FJumperTraversalStore::WallSlideDistance;
+
+int32 FJumperTraversalStore::Add(AJumperCharacter* Jumper)
+{
+	const int32 Handle = Jumpers.Add(Jumper);
+
+	Flags.Add(EJumperTraversalFlags::None);
+	Predicates.Add(EJumperTraversalPredicates::None);
+
+	LocationX.Add(0.0f);
+	LocationY.Add(0.0f);
+	LocationZ.Add(0.0f);
+	VelocityZ.Add(0.0f);
+
+	WallImpactX.Add(0.0f);
+	WallImpactY.Add(0.0f);
+	WallImpactZ.Add(0.0f);
+
+	WallNormalX.Add(0.0f);
+	WallNormalY.Add(0.0f);
+	WallNormalZ.Add(0.0f);
+
+	LedgeHeightX.Add(0.0f);
+	LedgeHeightY.Add(0.0f);
+	LedgeHeightZ.Add(0.0f);
+
+	return Handle;
+}
+
+void FJumperTraversalStore::RemoveSwap(int32 Handle)
+{
+	Jumpers.RemoveAtSwap(Handle, 1, false);
+
+	Flags.RemoveAtSwap(Handle, 1, false);
+	Predicates.RemoveAtSwap(Handle, 1, false);
+
+	LocationX.RemoveAtSwap(Handle, 1, false);
+	LocationY.RemoveAtSwap(Handle, 1, false);
+	LocationZ.RemoveAtSwap(Handle, 1, false);
+	VelocityZ.RemoveAtSwap(Handle, 1, false);
+
+	WallImpactX.RemoveAtSwap(Handle, 1, false);
+	WallImpactY.RemoveAtSwap(Handle, 1, false);
+	WallImpactZ.RemoveAtSwap(Handle, 1, false);
+
+	WallNormalX.RemoveAtSwap(Handle, 1, false);
+	WallNormalY.RemoveAtSwap(Handle, 1, false);
+	WallNormalZ.RemoveAtSwap(Handle, 1, false);
+
+	LedgeHeightX.RemoveAtSwap(Handle, 1, false);
+	LedgeHeightY.RemoveAtSwap(Handle, 1, false);
+	LedgeHeightZ.RemoveAtSwap(Handle, 1, false);
+
+	if (Jumpers.IsValidIndex(Handle))
+	{
+		// Its predicates were evaluated, if at all, under its old handle
+		Predicates[Handle] &= ~EJumperTraversalPredicates::Valid;
+		Jumpers[Handle]->SetTraversalHandle(Handle);
+	}
+}
+
+void FJumperTraversalStore::GatherMovement(const TArray<AJumperCharacter*>& Batch)
+{
+	for (const AJumperCharacter* Jumper : Batch)
+	{
+		const int32 Handle = Jumper->GetTraversalHandle();
+
+		const FVector Location = Jumper->GetActorLocation();
+		LocationX[Handle] = Location.X;
+		LocationY[Handle] = Location.Y;
+		LocationZ[Handle] = Location.Z;
+		VelocityZ[Handle] = Jumper->GetVelocity().Z;
+
+		// Read here rather than on movement mode changes, as states set MovementMode directly without a notification
+		SetFlag(Handle, EJumperTraversalFlags::Falling, Jumper->GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling);
+	}
+}
+
+void FJumperTraversalStore::EvaluatePredicates(const TArray<AJumperCharacter*>& Batch)
+{
+	// Invalidate the last evaluation, whose characters may have left the batch since
+	for (int32 Handle = ValidBegin; Handle < FMath::Min(ValidEnd, Predicates.Num()); ++Handle)
+	{
+		Predicates[Handle] &= ~EJumperTraversalPredicates::Valid;
+	}
+	ValidBegin = ValidEnd = 0;
+
+	if (Batch.Num() == 0)
+	{
+		return;
+	}
+
+	// Run the kernel over the handle range the batch spans; characters in that range but not in the batch get
+	// predicates without the Valid flag
+	int32 Begin = MAX_int32;
+	int32 End = 0;
+	for (const AJumperCharacter* Jumper : Batch)
+	{
+		Begin = FMath::Min(Begin, Jumper->GetTraversalHandle());
+		End = FMath::Max(End, Jumper->GetTraversalHandle() + 1);
+	}
+
+	JumperTraversalKernels::FInput Input;
+	Input.LocationX = LocationX.GetData() + Begin;
+	Input.LocationY = LocationY.GetData() + Begin;
+	Input.LocationZ = LocationZ.GetData() + Begin;
+	Input.VelocityZ = VelocityZ.GetData() + Begin;
+	Input.WallImpactX = WallImpactX.GetData() + Begin;
+	Input.WallImpactY = WallImpactY.GetData() + Begin;
+	Input.WallImpactZ = WallImpactZ.GetData() + Begin;
+	Input.Flags = reinterpret_cast<const uint8*>(Flags.GetData()) + Begin;
+	Input.Num = End - Begin;
+	Input.WallSlideDistanceSquared = WallSlideDistance * WallSlideDistance;
+	Input.MaxWallSlideVelocityZ = 5.0f;
+
+	// Same checks as the CanGrabLedge and CanWallSlide guards of JumperTransitions::CheckGuard
+	JumperTraversalKernels::EvaluatePredicates(Input, reinterpret_cast<uint8*>(Predicates.GetData()) + Begin, 0);
+
+	for (const AJumperCharacter* Jumper : Batch)
+	{
+		Predicates[Jumper->GetTraversalHandle()] |= EJumperTraversalPredicates::Valid;
+	}
+	ValidBegin = Begin;
+	ValidEnd = End;
+
+	PredicatesFrame = GFrameCounter;
+}
+
+EJumperTraversalPredicates FJumperTraversalStore::GetPredicates(int32 Handle) const
+{
+	if (PredicatesFrame != GFrameCounter || !EnumHasAnyFlags(Predicates[Handle], EJumperTraversalPredicates::Valid))
+	{
+		return EJumperTraversalPredicates::None;
+	}
+	return Predicates[Handle];
+}
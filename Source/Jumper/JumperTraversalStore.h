@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AJumperCharacter;
+
+/** Per-character traversal flags in FJumperTraversalStore */
+enum class EJumperTraversalFlags : uint8
+{
+	None		= 0,
+	NearFloor	= 1 << 0,
+	NearWall	= 1 << 1,
+	NearLedge	= 1 << 2,
+	Falling		= 1 << 3,	// Movement mode is MOVE_Falling
+};
+ENUM_CLASS_FLAGS(EJumperTraversalFlags);
+
+/** Results of the traversal predicates FJumperTraversalStore evaluates for all characters at once */
+enum class EJumperTraversalPredicates : uint8
+{
+	None			= 0,
+	CanGrabLedge	= 1 << 0,
+	CanWallSlide	= 1 << 1,
+	Valid			= 1 << 7,	// Cleared when the character's state changes after the predicates were evaluated
+};
+ENUM_CLASS_FLAGS(EJumperTraversalPredicates);
+
+/**
+ * Structure-of-arrays copy of the traversal data of every Jumper in a world, indexed by the handle the owning
+ * UJumperStateMachineSubsystem hands out. The per-frame traversal checks run over these packed arrays in one
+ * pass instead of touching each character object. AJumperCharacter keeps its Blueprint-facing properties and
+ * writes probe results to both. Location, velocity and movement mode are gathered, and only for the characters
+ * whose state reads the predicates.
+ */
+struct FJumperTraversalStore
+{
+	/** Adds a character with cleared traversal data and returns its handle */
+	int32 Add(AJumperCharacter* Jumper);
+
+	/** Removes a character; the last character is moved into its slot and gets its handle */
+	void RemoveSwap(int32 Handle);
+
+	int32 Num() const { return Jumpers.Num(); }
+
+	void SetFlag(int32 Handle, EJumperTraversalFlags Flag, bool bValue)
+	{
+		Flags[Handle] = bValue ? Flags[Handle] | Flag : Flags[Handle] & ~Flag;
+	}
+
+	/** Copies location, vertical velocity and movement mode from each character in Batch */
+	void GatherMovement(const TArray<AJumperCharacter*>& Batch);
+
+	/**
+	 * Evaluates the traversal predicates of the characters in Batch and marks them valid for the current frame;
+	 * the predicates of all other characters become invalid
+	 */
+	void EvaluatePredicates(const TArray<AJumperCharacter*>& Batch);
+
+	/** Returns the predicates evaluated this frame, or None if they are out of date for this character */
+	EJumperTraversalPredicates GetPredicates(int32 Handle) const;
+
+	/** Distance to the wall impact point under which a falling character may start sliding down the wall */
+	static constexpr float WallSlideDistance = 70.0f;
+
+	TArray<AJumperCharacter*> Jumpers;
+
+	TArray<EJumperTraversalFlags> Flags;
+	TArray<EJumperTraversalPredicates> Predicates;
+
+	TArray<float> LocationX;
+	TArray<float> LocationY;
+	TArray<float> LocationZ;
+	TArray<float> VelocityZ;
+
+	TArray<float> WallImpactX;
+	TArray<float> WallImpactY;
+	TArray<float> WallImpactZ;
+
+	TArray<float> WallNormalX;
+	TArray<float> WallNormalY;
+	TArray<float> WallNormalZ;
+
+	TArray<float> LedgeHeightX;
+	TArray<float> LedgeHeightY;
+	TArray<float> LedgeHeightZ;
+
+	/** Frame on which Predicates were last evaluated */
+	uint64 PredicatesFrame = MAX_uint64;
+
+	/** Handles range whose Predicates were last marked valid */
+	int32 ValidBegin = 0;
+	int32 ValidEnd = 0;
+};
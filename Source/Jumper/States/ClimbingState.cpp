@@ -1,13 +1,8 @@
 #include "States.h"
 
-Transition ClimbingState::GetTransition()
-{
-	return mTransition;
-}
-
 void ClimbingState::OnEnter()
 {
-	UE_LOG(LogTemp, Display, TEXT("Climbing On Enter"));
+	UE_LOG(LogJumperHSM, Verbose, TEXT("Climbing On Enter"));
 	Owner().CurrentState = EState::VE_Climbing;
 
 	AJumperCharacter& Jumper = Owner();
@@ -15,19 +10,5 @@ void ClimbingState::OnEnter()
 	Jumper.GetCharacterMovement()->MovementMode = EMovementMode::MOVE_Flying;
 
 	// Call ClimbingLedge event on the animation blueprint
-	auto AnimInstance = Cast<UObject>(Jumper.FindComponentByClass<USkeletalMeshComponent>()->GetAnimInstance());
-	if (AnimInstance->GetClass()->ImplementsInterface(UCharMoveInterface::StaticClass()))
-	{
-		Jumper.Execute_ClimbingLedge(AnimInstance, true);
-	}
-}
-
-void ClimbingState::Update(int EventId)
-{
-	//Check if we are on the floor
-	if (Owner().GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Walking)
-	{
-		mTransition = SiblingTransition<IdleState>();
-		return;
-	}
+	Jumper.NotifyMoveAnim(EMoveAnimNotify::ClimbingLedge, true);
 }
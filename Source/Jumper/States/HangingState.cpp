@@ -2,23 +2,16 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "States.h"
 
-hsm::Transition HangingState::GetTransition()
+void HangingState::OnTransition(const FJumperTransitionRule& Rule)
 {
-	return mTransition;
-}
-
-void HangingState::Update(int EventId)
-{
-	if (static_cast<EEventId>(EventId) == EEventId::Crouch)
+	if (Rule.Event == EEventId::Crouch)
 	{
 		Owner().GetCharacterMovement()->MovementMode = EMovementMode::MOVE_Falling;
-		mTransition = SiblingTransition<JumpingState>();
-		UE_LOG(LogTemp, Display, TEXT("Crouch!"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Crouch!"));
 	}
 
-	if (static_cast<EEventId>(EventId) == EEventId::Jump)
+	if (Rule.Event == EEventId::Jump)
 	{
-		mTransition = SiblingTransition<ClimbingState>();
-		UE_LOG(LogTemp, Display, TEXT("Hanging State Jump!"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Hanging State Jump!"));
 	}
 }
\ No newline at end of file
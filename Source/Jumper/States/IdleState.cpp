@@ -1,18 +1,11 @@
 #include "States.h"
 
-Transition IdleState::GetTransition()
+void IdleState::OnTransition(const FJumperTransitionRule& Rule)
 {
-	return mTransition;
-}
-
-void IdleState::Update(int EventId)
-{
-	if (static_cast<EEventId>(EventId) == EEventId::Jump)
+	// The CanJump guard made sure the jump will happen, as the jumping state waits for the landing that follows
+	if (Rule.To == EState::VE_Jumping)
 	{
-		// Do a Jump -> Maybe move to enter the jump state
 		Owner().GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
 		Owner().ACharacter::Jump();
-
-		mTransition = SiblingTransition<JumpingState>();
 	}
 }
\ No newline at end of file
@@ -3,113 +3,62 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "GameFramework/CharacterMovementComponent.h"
 
-Transition JumpingState::GetTransition()
+void JumpingState::OnTransition(const FJumperTransitionRule& Rule)
 {
-	return mTransition;
-}
-
-void JumpingState::Update(int EventId)
-{
-	// On Tick Event
-	if (static_cast<EEventId>(EventId) == EEventId::Tick)
+	switch (Rule.To)
 	{
-		//Check if we are on the floor
-		if (Owner().GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Walking)
-		{
-			mTransition = SiblingTransition<IdleState>();
-			return;
-		}
+	case EState::VE_Hanging:
+		GrabLedge();
+		break;
 
-		if (TryGrabLedge())
-		{
-			return;
-		}
+	case EState::VE_WallSliding:
+		WallSlide();
+		break;
 
-		TryWallSlide();
+	default:
+		break;
 	}
 }
 
-bool JumpingState::TryGrabLedge()
+void JumpingState::GrabLedge()
 {
 	AJumperCharacter& Jumper = Owner();
 
 	auto JumperCharacterMovement = Jumper.GetCharacterMovement();
 
-	if (!Jumper.IsNearFloor && Jumper.IsNearLedgeHeight && JumperCharacterMovement->MovementMode == EMovementMode::MOVE_Falling)
-	{
-		JumperCharacterMovement->StopMovementImmediately();
-
-		// Call GrabLedge event on the animation blueprint
-		auto AnimInstance = Cast<UObject>(Jumper.FindComponentByClass<USkeletalMeshComponent>()->GetAnimInstance());
-		if (AnimInstance->GetClass()->ImplementsInterface(UCharMoveInterface::StaticClass()))
-		{
-			Jumper.Execute_GrabLedge(AnimInstance, true);
-		}
-
-		JumperCharacterMovement->MovementMode = EMovementMode::MOVE_Flying;
-
-		FLatentActionInfo ActionInfo;
-		ActionInfo.CallbackTarget = &Jumper;
-		UKismetSystemLibrary::MoveComponentTo(
-			Jumper.GetCapsuleComponent(), 
-			Jumper.WallGoToLocation(Jumper.LedgeGrabHeightOffset, Jumper.LedgeGrabNormalOffset), 
-			Jumper.AllignToWall(), false, false, 0.1f, false, EMoveComponentAction::Move, ActionInfo);
-
-		// Reset movement
-		Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f);
-		Jumper.GetCharacterMovement()->GravityScale = 1.0f;
-		Jumper.GetCharacterMovement()->bNotifyApex = true;
-
-		mTransition = SiblingTransition<HangingState>();
-
-		return true;
-	}
-	
-	return false;
-}
-
-bool JumpingState::TryWallSlide()
-{
-	AJumperCharacter& Jumper = Owner();
-
-	if (CanDoWallSlide(70.0f))
-	{
-		// Wall sliding start
-		Jumper.SetActorRotation(Jumper.AllignToWall());
+	JumperCharacterMovement->StopMovementImmediately();
 
-		// Stop moving and stop rotations
-		Jumper.GetCharacterMovement()->Velocity = FVector(0.0f, 0.0f, 0.0f);
-		Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
+	// Call GrabLedge event on the animation blueprint
+	Jumper.NotifyMoveAnim(EMoveAnimNotify::GrabLedge, true);
 
-		// Call WallSliding event on the animation blueprint
-		auto AnimInstance = Cast<UObject>(Jumper.FindComponentByClass<USkeletalMeshComponent>()->GetAnimInstance());
-		if (AnimInstance->GetClass()->ImplementsInterface(UCharMoveInterface::StaticClass()))
-		{
-			Jumper.Execute_WallSliding(AnimInstance, true);
-		}
+	JumperCharacterMovement->MovementMode = EMovementMode::MOVE_Flying;
 
-		Jumper.GetCharacterMovement()->GravityScale = 0.3f;
+	FLatentActionInfo ActionInfo;
+	ActionInfo.CallbackTarget = &Jumper;
+	UKismetSystemLibrary::MoveComponentTo(
+		Jumper.GetCapsuleComponent(), 
+		Jumper.WallGoToLocation(Jumper.LedgeGrabHeightOffset, Jumper.LedgeGrabNormalOffset), 
+		Jumper.AllignToWall(), false, false, 0.1f, false, EMoveComponentAction::Move, ActionInfo);
 
-		mTransition = SiblingTransition<WallSlidingState>();
-
-		return true;
-	}
-
-	return false;
+	// Reset movement
+	Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f);
+	Jumper.GetCharacterMovement()->GravityScale = 1.0f;
+	Jumper.GetCharacterMovement()->bNotifyApex = true;
 }
 
-bool JumpingState::CanDoWallSlide(float Distance)
+void JumpingState::WallSlide()
 {
 	AJumperCharacter& Jumper = Owner();
 
-	// Check if we are close to the wall
-	bool bCanDoWallSlide = (Jumper.GetActorLocation() - Jumper.WallTraceImpact).Size() < Distance;
+	// Wall sliding start
+	Jumper.SetActorRotation(Jumper.AllignToWall());
 
-	bCanDoWallSlide &= Jumper.IsNearWall;
+	// Stop moving and stop rotations
+	Jumper.GetCharacterMovement()->Velocity = FVector(0.0f, 0.0f, 0.0f);
+	Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
 
-	bCanDoWallSlide &= !Jumper.IsNearFloor;
+	// Call WallSliding event on the animation blueprint
+	Jumper.NotifyMoveAnim(EMoveAnimNotify::WallSliding, true);
 
-	bCanDoWallSlide &= Jumper.GetVelocity().Z < 5.0f;
-
-	return bCanDoWallSlide;
-}
+	Jumper.GetCharacterMovement()->GravityScale = 0.3f;
+}
\ No newline at end of file
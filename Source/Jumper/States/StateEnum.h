@@ -16,7 +16,20 @@ enum class EState : uint8
 UENUM(BlueprintType)
 enum class EEventId : uint8
 {
-	Tick			UMETA(DisplayName = "Tick"),
-	Jump			UMETA(DisplayName = "Jump"),
-	Crouch			UMETA(DisplayName = "Crouch")
-};
\ No newline at end of file
+	Tick					UMETA(DisplayName = "Tick"),
+	Jump					UMETA(DisplayName = "Jump"),
+	Crouch					UMETA(DisplayName = "Crouch"),
+	Landed					UMETA(DisplayName = "Landed"),
+	MovementModeChanged		UMETA(DisplayName = "Movement Mode Changed")
+};
+
+// Traversal probes that a state needs refreshed while it is active
+enum class ETraversalProbes : uint8
+{
+	None	= 0,
+	Floor	= 1 << 0,
+	Wall	= 1 << 1,
+	Ledge	= 1 << 2,
+	All		= Floor | Wall | Ledge
+};
+ENUM_CLASS_FLAGS(ETraversalProbes);
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "StateTransitions.h"
+#include "States.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Transition Lookup"), STAT_JumperTransitionLookup, STATGROUP_Jumper);
+
+namespace
+{
+	template <typename StateType>
+	bool ValidateStateId()
+	{
+		EState State;
+		if (!GetStateEnum(GetStateType<StateType>(), State) || State != StateType::StateId)
+		{
+			UE_LOG(LogJumperHSM, Error, TEXT("GetStateEnum doesn't map %s to its StateId"), ANSI_TO_TCHAR(StateType::GetStaticStateName()));
+			return false;
+		}
+		return true;
+	}
+}
+
+const FJumperTransitionRule* JumperTransitions::FindTransition(EState From, EEventId Event, const AJumperCharacter& Jumper)
+{
+	SCOPE_CYCLE_COUNTER(STAT_JumperTransitionLookup);
+
+	const int32 Begin = RuleTable.Begin[static_cast<int32>(From)][static_cast<int32>(Event)];
+	const int32 End = RuleTable.End[static_cast<int32>(From)][static_cast<int32>(Event)];
+	for (int32 Index = Begin; Index < End; ++Index)
+	{
+		if (CheckGuard(Rules[Index].Guard, Jumper))
+		{
+			return &Rules[Index];
+		}
+	}
+	return nullptr;
+}
+
+bool JumperTransitions::CheckGuard(EJumperTransitionGuard Guard, const AJumperCharacter& Jumper)
+{
+	// The traversal checks use the predicates the subsystem evaluated in batch this frame when they are available
+	const EJumperTraversalPredicates Predicates = Guard == EJumperTransitionGuard::CanGrabLedge || Guard == EJumperTransitionGuard::CanWallSlide
+		? Jumper.GetTraversalPredicates() : EJumperTraversalPredicates::None;
+	const bool bHasPredicates = EnumHasAnyFlags(Predicates, EJumperTraversalPredicates::Valid);
+
+	switch (Guard)
+	{
+	case EJumperTransitionGuard::None:
+		return true;
+
+	case EJumperTransitionGuard::CanJump:
+		return Jumper.CanJump();
+
+	case EJumperTransitionGuard::Walking:
+		return Jumper.GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Walking;
+
+	case EJumperTransitionGuard::CanGrabLedge:
+		if (bHasPredicates)
+		{
+			return EnumHasAnyFlags(Predicates, EJumperTraversalPredicates::CanGrabLedge);
+		}
+		return !Jumper.IsNearFloor && Jumper.IsNearLedgeHeight && Jumper.GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling;
+
+	case EJumperTransitionGuard::CanWallSlide:
+		if (bHasPredicates)
+		{
+			return EnumHasAnyFlags(Predicates, EJumperTraversalPredicates::CanWallSlide);
+		}
+		return Jumper.IsNearWall && !Jumper.IsNearFloor && Jumper.GetVelocity().Z < 5.0f
+			&& (Jumper.GetActorLocation() - Jumper.WallTraceImpact).Size() < FJumperTraversalStore::WallSlideDistance;
+
+	case EJumperTransitionGuard::LostWall:
+		return Jumper.IsNearFloor || !Jumper.IsNearWall;
+	}
+	return false;
+}
+
+bool JumperTransitions::ValidateAtStartup()
+{
+	bool bValid = true;
+
+	// The reflected enums have an extra _MAX entry
+	if (StaticEnum<EState>()->NumEnums() - 1 != NumStates)
+	{
+		UE_LOG(LogJumperHSM, Error, TEXT("EState has %d values but the transition table expects %d"), StaticEnum<EState>()->NumEnums() - 1, NumStates);
+		bValid = false;
+	}
+	if (StaticEnum<EEventId>()->NumEnums() - 1 != NumEvents)
+	{
+		UE_LOG(LogJumperHSM, Error, TEXT("EEventId has %d values but the transition table expects %d"), StaticEnum<EEventId>()->NumEnums() - 1, NumEvents);
+		bValid = false;
+	}
+
+	bValid &= ValidateStateId<IdleState>();
+	bValid &= ValidateStateId<JumpingState>();
+	bValid &= ValidateStateId<HangingState>();
+	bValid &= ValidateStateId<ClimbingState>();
+	bValid &= ValidateStateId<WallSlidingState>();
+
+	UE_LOG(LogJumperHSM, Verbose, TEXT("Validated %d transition rules"), NumRules);
+	return bValid;
+}
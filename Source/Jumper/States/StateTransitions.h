@@ -0,0 +1,177 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StateEnum.h"
+
+class AJumperCharacter;
+
+// Condition on the character a transition rule requires besides its event; see JumperTransitions::CheckGuard
+enum class EJumperTransitionGuard : uint8
+{
+	None,			// Always taken
+	CanJump,		// ACharacter::CanJump, so a jump that won't happen doesn't leave Idle
+	Walking,		// Movement mode is MOVE_Walking
+	CanGrabLedge,	// Falling at ledge height, away from the floor
+	CanWallSlide,	// Close to a wall, away from the floor and not rising
+	LostWall,		// Near the floor or no longer facing a wall
+};
+
+// Every transition the Jumper states make: the state being left, the event being handled, the guard that must
+// hold and the state entered. BaseState looks the transitions up here; states only add the side effects.
+struct FJumperTransitionRule
+{
+	EState From;
+	EEventId Event;
+	EJumperTransitionGuard Guard;
+	EState To;
+};
+
+namespace JumperTransitions
+{
+	constexpr int32 NumStates = static_cast<int32>(EState::VE_WallSliding) + 1;
+	constexpr int32 NumEvents = static_cast<int32>(EEventId::MovementModeChanged) + 1;
+
+	// Rules of the same state and event are adjacent; the first whose guard holds is taken
+	constexpr FJumperTransitionRule Rules[] =
+	{
+		{ EState::VE_Idle,			EEventId::Jump,					EJumperTransitionGuard::CanJump,		EState::VE_Jumping },
+
+		{ EState::VE_Jumping,		EEventId::Landed,				EJumperTransitionGuard::None,			EState::VE_Idle },
+		{ EState::VE_Jumping,		EEventId::MovementModeChanged,	EJumperTransitionGuard::Walking,		EState::VE_Idle },
+		{ EState::VE_Jumping,		EEventId::Tick,					EJumperTransitionGuard::CanGrabLedge,	EState::VE_Hanging },
+		{ EState::VE_Jumping,		EEventId::Tick,					EJumperTransitionGuard::CanWallSlide,	EState::VE_WallSliding },
+
+		{ EState::VE_Hanging,		EEventId::Crouch,				EJumperTransitionGuard::None,			EState::VE_Jumping },
+		{ EState::VE_Hanging,		EEventId::Jump,					EJumperTransitionGuard::None,			EState::VE_Climbing },
+
+		{ EState::VE_Climbing,		EEventId::MovementModeChanged,	EJumperTransitionGuard::Walking,		EState::VE_Idle },
+
+		{ EState::VE_WallSliding,	EEventId::Tick,					EJumperTransitionGuard::LostWall,		EState::VE_Jumping },
+		{ EState::VE_WallSliding,	EEventId::Jump,					EJumperTransitionGuard::None,			EState::VE_Jumping },
+		{ EState::VE_WallSliding,	EEventId::Landed,				EJumperTransitionGuard::None,			EState::VE_Idle },
+	};
+
+	constexpr int32 NumRules = static_cast<int32>(sizeof(Rules) / sizeof(Rules[0]));
+
+	// For each state and event, the range of Rules to try; built from Rules at compile time
+	struct FRuleTable
+	{
+		uint8 Begin[NumStates][NumEvents];
+		uint8 End[NumStates][NumEvents];
+	};
+
+	constexpr FRuleTable BuildRuleTable()
+	{
+		FRuleTable Table = {};
+		for (int32 Index = NumRules - 1; Index >= 0; --Index)
+		{
+			const int32 From = static_cast<int32>(Rules[Index].From);
+			const int32 Event = static_cast<int32>(Rules[Index].Event);
+			if (Table.End[From][Event] == 0)
+			{
+				Table.End[From][Event] = static_cast<uint8>(Index + 1);
+			}
+			Table.Begin[From][Event] = static_cast<uint8>(Index);
+		}
+		return Table;
+	}
+
+	constexpr FRuleTable RuleTable = BuildRuleTable();
+
+	// Returns true if any rule leaves the state on the event
+	constexpr bool HasRules(EState State, EEventId Event)
+	{
+		return RuleTable.End[static_cast<int32>(State)][static_cast<int32>(Event)] != 0;
+	}
+
+	/** Returns the first rule for the state and event whose guard holds for the character, or null to stay */
+	const FJumperTransitionRule* FindTransition(EState From, EEventId Event, const AJumperCharacter& Jumper);
+
+	/** Evaluates a guard. Only reads the character, so it may run on a worker thread. */
+	bool CheckGuard(EJumperTransitionGuard Guard, const AJumperCharacter& Jumper);
+
+	// Validation of Rules, checked by the static_asserts below
+
+	constexpr bool HasValidRules()
+	{
+		for (int32 Index = 0; Index < NumRules; ++Index)
+		{
+			const FJumperTransitionRule& Rule = Rules[Index];
+			if (static_cast<int32>(Rule.From) >= NumStates || static_cast<int32>(Rule.To) >= NumStates || static_cast<int32>(Rule.Event) >= NumEvents
+				|| Rule.From == Rule.To)
+			{
+				return false;
+			}
+			for (int32 Other = 0; Other < Index; ++Other)
+			{
+				if (Rules[Other].From == Rule.From && Rules[Other].Event == Rule.Event && Rules[Other].To == Rule.To)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Bit per state that can be reached from Idle
+	constexpr uint32 GetReachableStates()
+	{
+		uint32 Reachable = 1 << static_cast<int32>(EState::VE_Idle);
+		for (bool bChanged = true; bChanged; )
+		{
+			bChanged = false;
+			for (int32 Index = 0; Index < NumRules; ++Index)
+			{
+				const uint32 ToBit = 1 << static_cast<int32>(Rules[Index].To);
+				if ((Reachable & (1 << static_cast<int32>(Rules[Index].From))) && !(Reachable & ToBit))
+				{
+					Reachable |= ToBit;
+					bChanged = true;
+				}
+			}
+		}
+		return Reachable;
+	}
+
+	// Bit per state that has at least one way out
+	constexpr uint32 GetStatesWithExits()
+	{
+		uint32 WithExits = 0;
+		for (int32 Index = 0; Index < NumRules; ++Index)
+		{
+			WithExits |= 1 << static_cast<int32>(Rules[Index].From);
+		}
+		return WithExits;
+	}
+
+	// Returns true if the rules of each state and event are adjacent, as FRuleTable's ranges require
+	constexpr bool HasAdjacentRules()
+	{
+		for (int32 Index = 0; Index < NumRules; ++Index)
+		{
+			const FRuleTable& Table = RuleTable;
+			const int32 From = static_cast<int32>(Rules[Index].From);
+			const int32 Event = static_cast<int32>(Rules[Index].Event);
+			for (int32 Other = Table.Begin[From][Event]; Other < Table.End[From][Event]; ++Other)
+			{
+				if (Rules[Other].From != Rules[Index].From || Rules[Other].Event != Rules[Index].Event)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	constexpr uint32 AllStates = (1u << NumStates) - 1;
+
+	static_assert(NumRules < 256, "FRuleTable stores rule indices in a byte");
+	static_assert(HasValidRules(), "Jumper transition rules must name valid states and events, not target their source state and not repeat");
+	static_assert(HasAdjacentRules(), "Jumper transition rules of the same state and event must be adjacent");
+	static_assert(GetReachableStates() == AllStates, "Every Jumper state must be reachable from Idle");
+	static_assert(GetStatesWithExits() == AllStates, "Every Jumper state must have a transition out of it");
+	static_assert(!HasRules(EState::VE_Idle, EEventId::Tick), "Dormant idle Jumpers get no Tick events, so Idle must only be left on queued events, which wake them");
+
+	/** Checks what can only be checked at runtime, such as the reflected enums matching NumStates and NumEvents. Returns false on errors, which are logged. */
+	bool ValidateAtStartup();
+}
@@ -1,28 +1,98 @@
 #pragma once
 
-#include "hsm.h"
 #include "CoreMinimal.h"
+#include "Jumper.h"
+#include "hsm.h"
 #include "JumperCharacter.h"
 #include "StateEnum.h"
+#include "StateTransitions.h"
 
 using namespace hsm;
 
+inline bool GetStateEnum(StateTypeId StateType, EState& OutState);
+inline Transition MakeSiblingTransition(EState State);
+
 struct BaseState : StateWithOwner<AJumperCharacter>
 {
 	DEFINE_HSM_STATE(BaseState)
 
+	// Probes this state reads, and every how many frames they must be refreshed
+	virtual ETraversalProbes GetRequiredProbes() const { return ETraversalProbes::None; }
+	virtual int32 GetProbeInterval() const { return 1; }
+
+	virtual EState GetStateId() const = 0;
+
+	// Whether this state handles the per-frame Tick event, i.e. a transition rule leaves it on Tick. While no state on
+	// the stack does, the character only dispatches the events it receives (input, landing, movement mode changes)
+	// and the machine is otherwise idle.
+	bool WantsTickEvents() const { return JumperTransitions::HasRules(GetStateId(), EEventId::Tick); }
+
+	// Update runs in two phases. Decide only reads the character (probe results, movement, transform) to look up
+	// the transition JumperTransitions::Rules takes on the event, so the subsystem can run it for many characters in
+	// parallel. Apply then performs the transition's side effects and sets mTransition on the game thread.
+	void Decide(EEventId EventId)
+	{
+		PendingRule = JumperTransitions::FindTransition(GetStateId(), EventId, Owner());
+	}
+
+	void Apply(EEventId EventId)
+	{
+		if (PendingRule)
+		{
+			OnTransition(*PendingRule);
+			mTransition = MakeSiblingTransition(PendingRule->To);
+			MarkTransitionDirty();
+			PendingRule = nullptr;
+		}
+	}
+
+	// Side effects of leaving this state by a rule, run on the game thread right before the transition is set
+	virtual void OnTransition(const FJumperTransitionRule& Rule) {}
+
+	virtual Transition GetTransition() override final
+	{
+		return mTransition;
+	}
+
+	// Runs Decide ahead of the event's Update, which then only applies the decision
+	void DecideAhead(EEventId EventId)
+	{
+		Decide(EventId);
+		bHasDecision = true;
+		DecidedEventId = EventId;
+	}
+
+	virtual void Update(int EventId) override final
+	{
+		const EEventId Event = static_cast<EEventId>(EventId);
+		if (!bHasDecision || DecidedEventId != Event)
+		{
+			Decide(Event);
+		}
+		bHasDecision = false;
+		Apply(Event);
+	}
+
+	// Only set by Apply (or in OnEnter), as the state machine only polls dirty transitions
 	Transition mTransition;
+
+	private:
+	const FJumperTransitionRule* PendingRule = nullptr;
+	bool bHasDecision = false;
+	EEventId DecidedEventId = EEventId::Tick;
 };
 
 struct IdleState : BaseState
 {
 	DEFINE_HSM_STATE(Idle)
-	virtual Transition GetTransition() override;
-	virtual void Update(int EventId) override;
+	static constexpr EState StateId = EState::VE_Idle;
+
+	virtual EState GetStateId() const override { return StateId; }
+	virtual void OnTransition(const FJumperTransitionRule& Rule) override;
 
 	virtual void OnEnter() 
 	{ 
-		UE_LOG(LogTemp, Display, TEXT("Idle On Enter"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Idle On Enter"));
 		Owner().CurrentState = EState::VE_Idle; 
 	}
 };
@@ -30,31 +100,39 @@ struct IdleState : BaseState
 struct JumpingState : BaseState
 {
 	DEFINE_HSM_STATE(Jumping)
+	static constexpr EState StateId = EState::VE_Jumping;
+
+	virtual EState GetStateId() const override { return StateId; }
 
 	virtual void OnEnter() override
 	{
 		Owner().CurrentState = EState::VE_Jumping;
-		UE_LOG(LogTemp, Display, TEXT("Jumping On Enter"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Jumping On Enter"));
 	}
 
-	virtual void Update(int EventId) override;
-	virtual Transition GetTransition() override;
+	virtual void OnTransition(const FJumperTransitionRule& Rule) override;
+	virtual ETraversalProbes GetRequiredProbes() const override { return ETraversalProbes::All; }
 
 	private:
-	bool TryGrabLedge();
-	bool TryWallSlide();
-	bool CanDoWallSlide(float Distance);
+	void GrabLedge();
+	void WallSlide();
 };
 
 struct HangingState : BaseState
 {
 	DEFINE_HSM_STATE(HangingState)
-	virtual void Update(int EventId) override;
-	virtual hsm::Transition GetTransition() override;
+	static constexpr EState StateId = EState::VE_Hanging;
+
+	virtual EState GetStateId() const override { return StateId; }
+	virtual void OnTransition(const FJumperTransitionRule& Rule) override;
+
+	// Only keeps the wall and ledge data fresh for the animation blueprint
+	virtual ETraversalProbes GetRequiredProbes() const override { return ETraversalProbes::Wall | ETraversalProbes::Ledge; }
+	virtual int32 GetProbeInterval() const override { return 4; }
 	
 	virtual void OnEnter() 
 	{ 
-		UE_LOG(LogTemp, Display, TEXT("Hanging On Enter"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Hanging On Enter"));
 		mTransition = NoTransition();
 		Owner().CurrentState = EState::VE_Hanging;
 	}
@@ -63,24 +141,52 @@ struct HangingState : BaseState
 struct ClimbingState : BaseState
 {
 	DEFINE_HSM_STATE(ClimbingState)
+	static constexpr EState StateId = EState::VE_Climbing;
 
-	virtual void Update(int EventId) override;
-	virtual Transition GetTransition() override;
+	virtual EState GetStateId() const override { return StateId; }
 	virtual void OnEnter() override;
 };
 
 struct WallSlidingState: BaseState
 {
 	DEFINE_HSM_STATE(WallSlidingState)
+	static constexpr EState StateId = EState::VE_WallSliding;
 
-	virtual Transition GetTransition() override;
-	virtual void Update(int EventId) override;
+	virtual EState GetStateId() const override { return StateId; }
+	virtual void OnTransition(const FJumperTransitionRule& Rule) override;
+	virtual ETraversalProbes GetRequiredProbes() const override { return ETraversalProbes::Floor | ETraversalProbes::Wall; }
 	virtual void OnEnter()
 	{
-		UE_LOG(LogTemp, Display, TEXT("Wall Sliding On Enter"));
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Wall Sliding On Enter"));
 		Owner().CurrentState = EState::VE_WallSliding;
 	}
 
 	private:
 	void StopWallSlide();
-};
\ No newline at end of file
+};
+
+// Maps a state type to its EState; returns false if it isn't one of the states above
+inline bool GetStateEnum(StateTypeId StateType, EState& OutState)
+{
+	if (StateType == GetStateType<IdleState>())				{ OutState = IdleState::StateId; }
+	else if (StateType == GetStateType<JumpingState>())		{ OutState = JumpingState::StateId; }
+	else if (StateType == GetStateType<HangingState>())		{ OutState = HangingState::StateId; }
+	else if (StateType == GetStateType<ClimbingState>())	{ OutState = ClimbingState::StateId; }
+	else if (StateType == GetStateType<WallSlidingState>())	{ OutState = WallSlidingState::StateId; }
+	else { return false; }
+	return true;
+}
+
+// Sibling transition to the state of an EState
+inline Transition MakeSiblingTransition(EState State)
+{
+	switch (State)
+	{
+	case EState::VE_Idle:			return SiblingTransition<IdleState>();
+	case EState::VE_Jumping:		return SiblingTransition<JumpingState>();
+	case EState::VE_Hanging:		return SiblingTransition<HangingState>();
+	case EState::VE_Climbing:		return SiblingTransition<ClimbingState>();
+	case EState::VE_WallSliding:	return SiblingTransition<WallSlidingState>();
+	}
+	return NoTransition();
+}
\ No newline at end of file
@@ -1,31 +1,16 @@
 #include "States.h"
 
-hsm::Transition WallSlidingState::GetTransition()
-{
-	return mTransition;
-}
-
-void WallSlidingState::Update(int EventId)
+void WallSlidingState::OnTransition(const FJumperTransitionRule& Rule)
 {
 	AJumperCharacter& Jumper = Owner();
 
-	// On Tick Event
-	// Stop wall sliding when near the floor or we don't have a wall to slide
-	if (static_cast<EEventId>(EventId) == EEventId::Tick)
-	{
-		if (Jumper.IsNearFloor || !Jumper.IsNearWall)
-		{
-			StopWallSlide();
-			mTransition = SiblingTransition<JumpingState>();
-		}
-	}
-	
+	// Losing the wall, or touching down before the floor probe noticed the floor, ends the slide right away
+	StopWallSlide();
+
 	// On Jump Event
-	if (static_cast<EEventId>(EventId) == EEventId::Jump)
+	if (Rule.Event == EEventId::Jump)
 	{
-		UE_LOG(LogTemp, Display, TEXT("Wall Sliding Jump Event"));
-
-		StopWallSlide();
+		UE_LOG(LogJumperHSM, Verbose, TEXT("Wall Sliding Jump Event"));
 
 		// Rotate 180
 		auto ActorRotation = Jumper.GetActorRotation();
@@ -38,8 +23,6 @@ void WallSlidingState::Update(int EventId)
 
 		// Stop the character from rotating
 		Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 0.0f, 0.0f);
-
-		mTransition = SiblingTransition<JumpingState>();
 	}
 }
 
@@ -48,11 +31,7 @@ void WallSlidingState::StopWallSlide()
 	AJumperCharacter& Jumper = Owner();
 
 	// Stop wall sliding animation
-	auto AnimInstance = Cast<UObject>(Owner().FindComponentByClass<USkeletalMeshComponent>()->GetAnimInstance());
-	if (AnimInstance->GetClass()->ImplementsInterface(UCharMoveInterface::StaticClass()))
-	{
-		Jumper.Execute_WallSliding(AnimInstance, false);
-	}
+	Jumper.NotifyMoveAnim(EMoveAnimNotify::WallSliding, false);
 
 	Jumper.GetCharacterMovement()->GravityScale = 1.0f;
 	Jumper.GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f);
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "Jumper.h"
+#include "JumperGameMode.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Fixed crowd, so runs of the benchmark can be compared with each other
+static const TCHAR* const CrowdMap = TEXT("/Game/World/Maps/TestMap");
+static const int32 CrowdCount = 1000;
+static const int32 CrowdSeed = 1;
+static const int32 CrowdWarmupFrames = 60;
+static const int32 CrowdMeasuredFrames = 600;
+
+static UWorld* GetCrowdWorld()
+{
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		if ((Context.WorldType == EWorldType::PIE || Context.WorldType == EWorldType::Game) && Context.World())
+		{
+			return Context.World();
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Spawns the fixed crowd with Jumper.StateMachine.Batched set to bBatched, waits out the warmup, then averages the
+ * frame time over the measured frames before destroying the crowd again
+ */
+class FJumperMeasureCrowdCommand : public IAutomationLatentCommand
+{
+public:
+	FJumperMeasureCrowdCommand(FAutomationTestBase* InTest, bool bInBatched, TSharedRef<TArray<double>> InFrameTimes)
+		: Test(InTest)
+		, bBatched(bInBatched)
+		, FrameTimes(InFrameTimes)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		UWorld* World = GetCrowdWorld();
+		AJumperGameMode* GameMode = World ? World->GetAuthGameMode<AJumperGameMode>() : nullptr;
+		if (!GameMode)
+		{
+			Test->AddError(FString::Printf(TEXT("%s isn't running with AJumperGameMode"), CrowdMap));
+			return true;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		if (Frame == 0)
+		{
+			IConsoleManager::Get().FindConsoleVariable(TEXT("Jumper.StateMachine.Batched"))->Set(bBatched ? 1 : 0);
+			GameMode->SpawnJumperCrowd(CrowdCount, 150.0f, CrowdSeed);
+		}
+		else if (Frame == CrowdWarmupFrames)
+		{
+			MeasureStart = Now;
+		}
+		else if (Frame == CrowdWarmupFrames + CrowdMeasuredFrames)
+		{
+			GameMode->DestroyJumperCrowd();
+			FrameTimes->Add((Now - MeasureStart) * 1000.0 / CrowdMeasuredFrames);
+			return true;
+		}
+
+		++Frame;
+		return false;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	bool bBatched;
+	TSharedRef<TArray<double>> FrameTimes;
+	int32 Frame = 0;
+	double MeasureStart = 0.0;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJumperCrowdBatchingTest, "Jumper.Crowd.StateMachineBatching",
+	EAutomationTestFlags::ClientContext | EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+/**
+ * Runs the same seeded crowd of Jumpers with per-actor and batched state machine updates and logs the average frame
+ * time of each, e.g. headless with:
+ *
+ *   UE4Editor-Cmd.exe Jumper.uproject -game -nullrhi -unattended -ExecCmds="Automation RunTests Jumper.Crowd; Quit"
+ */
+bool FJumperCrowdBatchingTest::RunTest(const FString& Parameters)
+{
+	AutomationOpenMap(CrowdMap);
+
+	IConsoleVariable* BatchedVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("Jumper.StateMachine.Batched"));
+	if (!TestNotNull(TEXT("Jumper.StateMachine.Batched"), BatchedVariable))
+	{
+		return false;
+	}
+	const int32 OriginalBatched = BatchedVariable->GetInt();
+
+	TSharedRef<TArray<double>> FrameTimes = MakeShared<TArray<double>>();
+	ADD_LATENT_AUTOMATION_COMMAND(FJumperMeasureCrowdCommand(this, false, FrameTimes));
+	ADD_LATENT_AUTOMATION_COMMAND(FJumperMeasureCrowdCommand(this, true, FrameTimes));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, FrameTimes, OriginalBatched]()
+	{
+		IConsoleManager::Get().FindConsoleVariable(TEXT("Jumper.StateMachine.Batched"))->Set(OriginalBatched);
+
+		if (FrameTimes->Num() == 2)
+		{
+			UE_LOG(LogJumperHSM, Display, TEXT("Crowd of %d Jumpers (seed %d) over %d frames: per-actor %.3f ms/frame, batched %.3f ms/frame"),
+				CrowdCount, CrowdSeed, CrowdMeasuredFrames, (*FrameTimes)[0], (*FrameTimes)[1]);
+			AddInfo(FString::Printf(TEXT("Per-actor %.3f ms/frame, batched %.3f ms/frame"), (*FrameTimes)[0], (*FrameTimes)[1]));
+		}
+		return true;
+	}));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "JumperProbeCache.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJumperProbeCacheHitsWhileMovingTest, "Jumper.ProbeCache.HitsWhileMoving",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJumperProbeCacheHitsWhileMovingTest::RunTest(const FString& Parameters)
+{
+	// A 100 unit wall probe along +X hitting a wall facing -X at X = 60, so 40 units of the probe are left beyond the hit
+	const FVector Start(0.0f, 0.0f, 50.0f);
+	const FVector Direction(1.0f, 0.0f, 0.0f);
+	const float ProbeLength = 100.0f;
+	const float MaxDistance = 25.0f;
+
+	FHitResult Hit(nullptr, nullptr, FVector(60.0f, 0.0f, 50.0f), -Direction);
+	Hit.bBlockingHit = true;
+	Hit.Time = 0.6f;
+
+	FJumperProbeCache Cache;
+	Cache.Store(Start, Start + Direction * ProbeLength, &Hit, true, MaxDistance);
+
+	// Run alongside the wall at 2 units a frame: the hit is reused, following the character, until it has moved MaxDistance
+	const FVector Step(0.0f, 2.0f, 0.0f);
+	int32 ReusedFrames = 0;
+	for (int32 Frame = 1; Frame <= 20; ++Frame)
+	{
+		const FVector FrameStart = Start + Step * Frame;
+		FHitResult CachedHit;
+		bool bCachedHit = false;
+		if (!Cache.Reuse(FrameStart, FrameStart + Direction * ProbeLength, CachedHit, bCachedHit))
+		{
+			break;
+		}
+
+		++ReusedFrames;
+		TestTrue(TEXT("Reused result is a hit"), bCachedHit);
+		TestEqual(TEXT("Impact follows the character along the wall"), CachedHit.ImpactPoint, FVector(60.0f, FrameStart.Y, 50.0f));
+		TestEqual(TEXT("Impact normal is kept"), CachedHit.ImpactNormal, -Direction);
+	}
+	TestEqual(TEXT("Hit is reused while the probe moved no further than MaxDistance"), ReusedFrames, 12);
+
+	// Backing away from the wall is bounded by the 40 units of probe beyond the hit rather than MaxDistance
+	Cache.Store(Start, Start + Direction * ProbeLength, &Hit, true, 1000.0f);
+	{
+		FHitResult CachedHit;
+		bool bCachedHit = false;
+		TestTrue(TEXT("Hit is reused while the wall stays in reach"), Cache.Reuse(Start - Direction * 39.0f, Start + Direction * 61.0f, CachedHit, bCachedHit));
+		TestFalse(TEXT("Hit is traced again once the wall may be out of reach"), Cache.Reuse(Start - Direction * 41.0f, Start + Direction * 59.0f, CachedHit, bCachedHit));
+	}
+
+	// Hits on geometry that may move are never reused
+	Cache.Store(Start, Start + Direction * ProbeLength, &Hit, false, MaxDistance);
+	{
+		FHitResult CachedHit;
+		bool bCachedHit = false;
+		TestFalse(TEXT("Movable hit is not reused"), Cache.Reuse(Start, Start + Direction * ProbeLength, CachedHit, bCachedHit));
+	}
+
+	// A miss only holds for the segment that was traced
+	Cache.Store(Start, Start + Direction * ProbeLength, nullptr, true, MaxDistance);
+	{
+		FHitResult CachedHit;
+		bool bCachedHit = true;
+		TestTrue(TEXT("Miss is reused while the probe holds still"), Cache.Reuse(Start, Start + Direction * ProbeLength, CachedHit, bCachedHit));
+		TestFalse(TEXT("Reused miss is not a hit"), bCachedHit);
+		TestFalse(TEXT("Miss is traced again once the probe moves"), Cache.Reuse(Start + Step, Start + Step + Direction * ProbeLength, CachedHit, bCachedHit));
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -11,8 +11,12 @@
 
 // Required includes
 #include <cstdarg>
+#include <cstddef>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <type_traits>
 
 #pragma once
 #ifndef __HSM_H__
@@ -48,6 +52,8 @@
 // Config
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <atomic>   // for StateTypeId indices
+
 // Includes required for macros defined below. You can remove/replace them if you modify the macros.
 #include <vector>   // for HSM_STD_VECTOR
 #include <map>      // for HSM_STD_MAP
@@ -77,13 +83,61 @@
 #define HSM_ASSERT_MSG(cond, msg) assert((cond) && msg)
 #define HSM_NEW new
 #define HSM_DELETE delete
+#define HSM_ALLOC_STORAGE(size) ::operator new(size)
+#define HSM_FREE_STORAGE(ptr) ::operator delete(ptr)
 #define HSM_DEBUG_NAME_MAXLEN 128
+#define HSM_LOG_LINE_MAXLEN 512 // Longer log lines are truncated
+
+// State stack (see StateStack): the maximum number of states on the stack at once, and the size in bytes of the
+// inline slot each depth has for its state. States larger than a slot are allocated (or pooled) instead.
+#if !defined(HSM_MAX_STACK_DEPTH)
+#define HSM_MAX_STACK_DEPTH 16
+#endif
+#if !defined(HSM_STATE_SLOT_SIZE)
+#define HSM_STATE_SLOT_SIZE 256
+#endif
+
+// StateValues (see State::SetStateValue): the maximum number of StateValues that the states on the stack can
+// have set at once, and the maximum size of a StateValue's type. Original values are kept in a fixed-size undo
+// log in the state machine, so setting StateValues never allocates; a type that doesn't fit is a compile-time error.
+#if !defined(HSM_STATE_VALUE_CAPACITY)
+#define HSM_STATE_VALUE_CAPACITY 16
+#endif
+#if !defined(HSM_STATE_VALUE_MAX_SIZE)
+#define HSM_STATE_VALUE_MAX_SIZE 32
+#endif
+
+// Error hook: reports, in all builds, a condition the state machine recovers from but that leaves it behaving
+// differently than the client expects, such as a StateValue that won't be restored. Called with a narrow string
+// literal. Define before including hsm.h to route it to a logger or to halt.
+#if !defined(HSM_REPORT_ERROR)
+#define HSM_REPORT_ERROR(msg) ::fprintf(stderr, "HSM ERROR: %s\n", msg)
+#endif
+
+// Size in bytes of the inline buffer in which transitions store the args for the target state's OnEnter.
+// Transitions never allocate; passing args that don't fit is a compile-time error.
+#if !defined(HSM_ON_ENTER_ARGS_BUFFER_SIZE)
+#define HSM_ON_ENTER_ARGS_BUFFER_SIZE 64
+#endif
 
 //#define HSM_STATE_UPDATE_ARGS void
 //#define HSM_STATE_UPDATE_ARGS_FORWARD
 #define HSM_STATE_UPDATE_ARGS int EventId
 #define HSM_STATE_UPDATE_ARGS_FORWARD EventId
 
+// Event queue (see StateMachine::QueueEvent): the type of a queued event, which is passed as the single
+// argument to UpdateStates, and the maximum number of events that can be queued between dispatches.
+#define HSM_EVENT_TYPE int
+#if !defined(HSM_EVENT_QUEUE_CAPACITY)
+#define HSM_EVENT_QUEUE_CAPACITY 16
+#endif
+
+// Profiling hook: opens a named profiler scope that lasts until the end of the enclosing block. Used around
+// UpdateStates and ProcessStateTransitions. Define before including hsm.h to route it to a profiler.
+#if !defined(HSM_PROFILE_SCOPE)
+#define HSM_PROFILE_SCOPE(Name)
+#endif
+
 typedef bool hsm_bool;
 #define hsm_true true
 #define hsm_false false
@@ -139,38 +193,69 @@ typedef void Owner;
 #define HSM_USE_CPP_RTTI
 #endif
 
-#ifdef HSM_USE_CPP_RTTI
-
-#include <typeinfo>
-
 namespace hsm {
 
-// We use standard C++ RTTI
-
-// We need a copyable wrapper around std::type_info since std::type_info is non-copyable
+// State types are identified by a dense integer index (0, 1, 2, ...) that is assigned the first time the
+// StateTypeId of a type is requested. This does not depend on C++ RTTI: comparing two StateTypeIds is a
+// single integer compare, and the index can be used directly to look up per-state-type tables (see
+// GetNumStateTypes). Indices are unique within a program, but depend on the order in which types are first
+// used, so they must not be serialized or compared across runs.
 struct StateTypeId
 {
-	StateTypeId() : mTypeInfo(0) {}
-	StateTypeId(const std::type_info& typeInfo) : mTypeInfo(&typeInfo) {}
+	StateTypeId() : mIndex(~static_cast<size_t>(0)) {}
+	explicit StateTypeId(size_t index) : mIndex(index) {}
 	hsm_bool operator==(const StateTypeId& rhs) const
 	{
-		HSM_ASSERT_MSG(mTypeInfo != 0, "mTypeInfo was not properly initialized");
-		return *mTypeInfo == *rhs.mTypeInfo;
+		HSM_ASSERT_MSG(IsValid(), "StateTypeId was not properly initialized");
+		return mIndex == rhs.mIndex;
 	}
-	const std::type_info* mTypeInfo;
+	hsm_bool operator!=(const StateTypeId& rhs) const { return !(*this == rhs); }
+	hsm_bool IsValid() const { return mIndex != ~static_cast<size_t>(0); }
+	size_t GetIndex() const { return mIndex; }
+	size_t mIndex;
 };
 
+namespace detail
+{
+	inline std::atomic<size_t>& GetStateTypeIndexCounter()
+	{
+		static std::atomic<size_t> sCounter(0);
+		return sCounter;
+	}
+
+	template <typename StateType>
+	size_t GetStateTypeIndex()
+	{
+		static const size_t sIndex = GetStateTypeIndexCounter()++;
+		return sIndex;
+	}
+}
+
+// Returns the number of state type indices assigned so far; all StateTypeId indices are less than this value
+inline size_t GetNumStateTypes()
+{
+	return detail::GetStateTypeIndexCounter().load();
+}
+
 template <typename StateType>
-const StateTypeId& GetStateType()
+StateTypeId GetStateType()
 {
-	static StateTypeId stateTypeId(typeid(StateType));
-	return stateTypeId;
+	return StateTypeId(detail::GetStateTypeIndex<StateType>());
 }
 
+} // namespace hsm
+
+#ifdef HSM_USE_CPP_RTTI
+
+#include <typeinfo>
+
+namespace hsm {
+
+// With C++ RTTI, state names are returned from std::type_info; they are usually less human readable
 template <typename StateType>
 const char* GetStateName()
 {
-	return GetStateType<StateType>().mTypeInfo->name();
+	return typeid(StateType).name();
 }
 
 } // namespace hsm
@@ -183,42 +268,20 @@ const char* GetStateName()
 
 namespace hsm {
 
-// Standard C++ RTTI is not available, so we roll our own custom RTTI. All states are required to use the
-// DEFINE_HSM_STATE macro, which makes use of the input name of the state as the unique identifier. String
-// compares are used to determine equality.
-
-// We need a comparable wrapper around the type name. We can't just compare const char* pointers
-// because GetTypeName<T> may return two different strings for the same T in different translation units.
-struct StateTypeId
-{
-	StateTypeId(const hsm_char* aStateName = 0) : mStateName(aStateName) {}
-	hsm_bool operator==(const StateTypeId& rhs) const
-	{
-		HSM_ASSERT_MSG(mStateName != 0, "StateTypeId was not properly initialized");
-		return STRCMP(mStateName, rhs.mStateName) == 0;
-	}
-	const hsm_char* mStateName;
-};
-	
-template <typename StateType>
-StateTypeId GetStateType()
-{
-	return StateType::GetStaticStateType();
-}
-
+// Standard C++ RTTI is not available, so state names are provided by the DEFINE_HSM_STATE macro, which
+// all states are required to use.
 template <typename StateType>
 const char* GetStateName()
 {
-	return GetStateType<StateType>().mStateName;
+	return StateType::GetStaticStateName();
 }
 
 } // namespace hsm
 
-// Must use this macro in every State to add RTTI support.
+// Must use this macro in every State to provide its name.
 #define DEFINE_HSM_STATE(__StateName__) \
-	static hsm::StateTypeId GetStaticStateType() { static hsm::StateTypeId sStateTypeId(HSM_TEXT(#__StateName__)); return sStateTypeId; } \
-	virtual hsm::StateTypeId DoGetStateType() const { return GetStaticStateType(); } \
-	virtual const hsm_char* DoGetStateDebugName() const { return HSM_TEXT(#__StateName__); }
+	static const hsm_char* GetStaticStateName() { return HSM_TEXT(#__StateName__); } \
+	virtual const hsm_char* DoGetStateDebugName() const { return GetStaticStateName(); }
 
 #endif // !HSM_USE_CPP_RTTI
 
@@ -249,6 +312,12 @@ struct StateFactory
 	virtual StateTypeId GetStateType() const = 0;
 	virtual const char* GetStateName() const = 0;
 	virtual State* AllocateState() const = 0;
+
+	// Used by pooling state machines and the state stack's inline slots to construct states in previously allocated storage
+	virtual size_t GetStateSize() const = 0;
+	virtual size_t GetStateAlignment() const = 0;
+	virtual State* ConstructState(void* storage) const = 0;
+	virtual void* DestructState(State* state) const = 0; // Returns the storage passed to ConstructState
 };
 
 inline bool operator==(const StateFactory& lhs, const StateFactory& rhs) { return lhs.GetStateType() == rhs.GetStateType(); }
@@ -274,6 +343,28 @@ struct ConcreteStateFactory : StateFactory
 		return HSM_NEW TargetState();
 	}
 
+	virtual size_t GetStateSize() const
+	{
+		return sizeof(TargetState);
+	}
+
+	virtual size_t GetStateAlignment() const
+	{
+		return std::alignment_of<TargetState>::value;
+	}
+
+	virtual State* ConstructState(void* storage) const
+	{
+		return ::new (storage) TargetState();
+	}
+
+	virtual void* DestructState(State* state) const
+	{
+		TargetState* targetState = static_cast<TargetState*>(state);
+		targetState->~TargetState();
+		return targetState;
+	}
+
 private:
 	// Only GetStateFactory can create this type
 	friend const StateFactory& GetStateFactory<TargetState>();
@@ -298,7 +389,87 @@ struct StateOverride
 	const StateFactory& mStateFactory;
 };
 
-typedef std::function<void (State*)> OnEnterArgsFunc;
+// Type-erased callable that invokes the target state's OnEnter with the args passed to a transition function.
+// Unlike std::function, the callable (and so the captured args) is always stored inline, and an empty
+// OnEnterArgsFunc - the common case of a transition without args - copies as a single null pointer.
+class OnEnterArgsFunc
+{
+public:
+	OnEnterArgsFunc() : mOps(0) {}
+
+	template <typename Func, typename = typename std::enable_if<!std::is_same<typename std::decay<Func>::type, OnEnterArgsFunc>::value>::type>
+	explicit OnEnterArgsFunc(Func&& func)
+	{
+		typedef typename std::decay<Func>::type FuncType;
+		static_assert(sizeof(FuncType) <= sizeof(mStorage), "OnEnter args too large, increase HSM_ON_ENTER_ARGS_BUFFER_SIZE");
+		static_assert(std::alignment_of<FuncType>::value <= std::alignment_of<StorageType>::value, "OnEnter args alignment not supported");
+		::new (&mStorage) FuncType(std::forward<Func>(func));
+		mOps = &OpsFor<FuncType>::sOps;
+	}
+
+	OnEnterArgsFunc(const OnEnterArgsFunc& rhs)
+		: mOps(rhs.mOps)
+	{
+		if (mOps)
+			mOps->mCopy(&mStorage, &rhs.mStorage);
+	}
+
+	OnEnterArgsFunc& operator=(const OnEnterArgsFunc& rhs)
+	{
+		if (this != &rhs)
+		{
+			Reset();
+			mOps = rhs.mOps;
+			if (mOps)
+				mOps->mCopy(&mStorage, &rhs.mStorage);
+		}
+		return *this;
+	}
+
+	~OnEnterArgsFunc() { Reset(); }
+
+	explicit operator bool() const { return mOps != 0; }
+
+	void operator()(State* state) const
+	{
+		HSM_ASSERT(mOps != 0);
+		mOps->mInvoke(&mStorage, state);
+	}
+
+private:
+	void Reset()
+	{
+		if (mOps)
+		{
+			mOps->mDestroy(&mStorage);
+			mOps = 0;
+		}
+	}
+
+	struct Ops
+	{
+		void (*mInvoke)(const void* func, State* state);
+		void (*mCopy)(void* dest, const void* src);
+		void (*mDestroy)(void* func);
+	};
+
+	template <typename Func>
+	struct OpsFor
+	{
+		static void Invoke(const void* func, State* state) { (*static_cast<const Func*>(func))(state); }
+		static void Copy(void* dest, const void* src) { ::new (dest) Func(*static_cast<const Func*>(src)); }
+		static void Destroy(void* func) { static_cast<Func*>(func)->~Func(); }
+		static const Ops sOps;
+	};
+
+	typedef std::aligned_storage<HSM_ON_ENTER_ARGS_BUFFER_SIZE>::type StorageType;
+
+	const Ops* mOps; // Null if no args
+	StorageType mStorage;
+};
+
+template <typename Func>
+const OnEnterArgsFunc::Ops OnEnterArgsFunc::OpsFor<Func>::sOps = { &Invoke, &Copy, &Destroy };
 
 namespace detail
 {
@@ -451,9 +622,6 @@ class StateMachine;
 
 // StateValue
 
-template <typename T>
-struct ConcreteStateValueResetter;
-
 template <typename T>
 struct StateValue
 {
@@ -477,32 +645,102 @@ private:
 	StateValue(const StateValue& rhs);
 	StateValue& operator=(StateValue& rhs);
 
-	friend struct ConcreteStateValueResetter<T>;
+	friend class StateValueUndoLog;
 	friend struct State;
 	T mValue;
 };
 
-struct StateValueResetter
+// Original values of the StateValues set by the states on the stack, tagged with the depth of the state that set
+// them, so they can be restored when that state is exited. Entries live in a fixed array and store the original
+// value inline; entries freed in the middle (by an inner state exiting before its outer's later entries) are reused.
+class StateValueUndoLog
 {
-	virtual ~StateValueResetter() {}
-};
+public:
+	StateValueUndoLog() : mSize(0) {}
+	~StateValueUndoLog() { HSM_ASSERT(mSize == 0); }
 
-template <typename T>
-struct ConcreteStateValueResetter : StateValueResetter
-{
-	ConcreteStateValueResetter(StateValue<T>& stateValue)
+	// Saves the value of stateValue to restore when the state at depth exits, unless already saved for that depth.
+	// Returns false if the log is full, in which case the value won't be restored; this is reported through
+	// HSM_REPORT_ERROR and asserted on.
+	template <typename T>
+	hsm_bool Save(size_t depth, StateValue<T>& stateValue)
 	{
-		mStateValue = &stateValue;
-		mOrigValue = stateValue.mValue;
+		static_assert(sizeof(T) <= HSM_STATE_VALUE_MAX_SIZE, "StateValue type too large, increase HSM_STATE_VALUE_MAX_SIZE");
+		static_assert(std::alignment_of<T>::value <= std::alignment_of<ValueStorageType>::value, "StateValue type alignment not supported");
+
+		Entry* freeEntry = 0;
+		for (size_t i = 0; i < mSize; ++i)
+		{
+			Entry& entry = mEntries[i];
+			if (entry.mStateValue == &stateValue && entry.mDepth == depth)
+				return hsm_true;
+			if (!entry.mStateValue && !freeEntry)
+				freeEntry = &entry;
+		}
+
+		if (!freeEntry)
+		{
+			if (mSize == HSM_STATE_VALUE_CAPACITY)
+			{
+				HSM_REPORT_ERROR("Too many StateValues set, the original value won't be restored; increase HSM_STATE_VALUE_CAPACITY");
+				HSM_ASSERT_MSG(hsm_false, "Too many StateValues set, increase HSM_STATE_VALUE_CAPACITY");
+				return hsm_false;
+			}
+			freeEntry = &mEntries[mSize++];
+		}
+
+		freeEntry->mStateValue = &stateValue;
+		freeEntry->mRestore = &Restore<T>;
+		freeEntry->mDepth = depth;
+		::new (&freeEntry->mOrigValue) T(stateValue.mValue);
+		return hsm_true;
 	}
 
-	virtual ~ConcreteStateValueResetter()
+	// Restores the StateValues saved for depth, most recently saved first
+	void RestoreDepth(size_t depth)
 	{
-		mStateValue->mValue = mOrigValue;
+		for (size_t i = mSize; i > 0; --i)
+		{
+			Entry& entry = mEntries[i - 1];
+			if (entry.mStateValue && entry.mDepth == depth)
+			{
+				entry.mRestore(entry.mStateValue, &entry.mOrigValue);
+				entry.mStateValue = 0;
+			}
+		}
+
+		while (mSize > 0 && !mEntries[mSize - 1].mStateValue)
+		{
+			--mSize;
+		}
 	}
 
-	StateValue<T>* mStateValue;
-	T mOrigValue;
+private:
+	typedef std::aligned_storage<HSM_STATE_VALUE_MAX_SIZE, std::alignment_of<std::max_align_t>::value>::type ValueStorageType;
+
+	struct Entry
+	{
+		void* mStateValue; // NULL if the entry is free
+		void (*mRestore)(void* stateValue, void* origValue);
+		size_t mDepth;
+		ValueStorageType mOrigValue;
+	};
+
+	// Assigns the original value back and destroys the saved copy
+	template <typename T>
+	static void Restore(void* stateValue, void* origValue)
+	{
+		T* value = static_cast<T*>(origValue);
+		static_cast<StateValue<T>*>(stateValue)->mValue = *value;
+		value->~T();
+	}
+
+	// Entries point to StateValues owned elsewhere, so the log can't be copied
+	StateValueUndoLog(const StateValueUndoLog&);
+	StateValueUndoLog& operator=(const StateValueUndoLog&);
+
+	Entry mEntries[HSM_STATE_VALUE_CAPACITY];
+	size_t mSize; // One past the last used entry
 };
 
 
@@ -518,7 +756,7 @@ struct State
 	State()
 		: mOwnerStateMachine(0)
 		, mStackDepth(0)
-		, mStateValueResetters(0)
+		, mStateFactory(0)
 		, mStateDebugName(0)
 	{
 	}
@@ -587,19 +825,13 @@ struct State
 
 	// Called from state functions (usually OnEnter()) to bind a StateValue to current state. Rather than
 	// passing in the new value, we return a writable reference to the StateValue's internal value to support
-	// modifying data members of structs/classes.
+	// modifying data members of structs/classes. The original value is restored when this state exits.
 	template <typename T>
-	T& SetStateValue(StateValue<T>& stateValue)
-	{
-		// Lazily add a resetter for this StateValue
-		if (!FindStateValueInResetterList(stateValue))
-		{
-			mStateValueResetters.push_back( HSM_NEW ConcreteStateValueResetter<T>(stateValue) );
-		}
+	T& SetStateValue(StateValue<T>& stateValue);
 
-		// Return its value so it can be modified
-		return stateValue.mValue;
-	}
+	// When the state machine only processes dirty transitions (see StateMachine::SetDirtyTransitionsEnabled),
+	// call this whenever the value GetTransition() returns may have changed, so it gets called again
+	void MarkTransitionDirty();
 
 	// Overridable functions
 
@@ -637,43 +869,18 @@ struct State
 	StateOverride<SourceState> GetStateOverride();
 
 private:
+	friend class StateMachine;
 	friend void detail::InitState(State* state, StateMachine* ownerStateMachine, size_t stackDepth, const StateFactory& stateFactory);
 
-	template <typename T>
-	StateValue<T>* FindStateValueInResetterList(StateValue<T>& stateValue)
-	{
-		StateValueResetterList::iterator iter = mStateValueResetters.begin();
-		const StateValueResetterList::iterator& iterEnd = mStateValueResetters.end();
-		for ( ; iter != iterEnd; ++iter)
-		{
-			if (&stateValue == static_cast<ConcreteStateValueResetter<T>*>(*iter)->mStateValue)
-			{
-				return &stateValue;
-			}
-		}
-		return 0;
-	}
-
-	void ResetStateValues()
-	{
-		// Destroy StateValues (will reset to old value)
-		StateValueResetterList::iterator iter = mStateValueResetters.begin();
-		const StateValueResetterList::iterator& iterEnd = mStateValueResetters.end();
-		for ( ; iter != iterEnd; ++iter)
-		{
-			HSM_DELETE(*iter);
-		}
-		mStateValueResetters.clear();
-	}
-
-	typedef HSM_STD_VECTOR<StateValueResetter*> StateValueResetterList;
+	// Restores the StateValues this state set
+	void ResetStateValues();
 
 	StateMachine* mOwnerStateMachine;
 	Owner* mOwner; // Cached for performance and easier debugging
 	size_t mStackDepth; // Depth of this state instance on the stack
-	StateValueResetterList mStateValueResetters;
 
 	// Values cached to avoid virtual call, especially since the values are constant
+	const StateFactory* mStateFactory;
 	StateTypeId mStateTypeId;
 	const hsm_char* mStateDebugName;
 };
@@ -698,13 +905,13 @@ namespace detail
 
 		// Purposely capture args by copy rather than by reference in case args are
 		// created on the stack. Use std::ref() to wrap args that do not need to be copied.
-		return[args...](State* state)
+		return OnEnterArgsFunc([args...](State* state)
 		{
 			HSM_ASSERT_MSG(state->GetStateType() == GetStateType<TargetState>(),
 				"Type of state to call OnEnter on doesn't match original target state returned by transition");
 
 			static_cast<TargetState*>(state)->OnEnter(std::move(args)...);
-		};
+		});
 	}
 
 	// Base case: do nothing
@@ -780,8 +987,106 @@ private:
 
 namespace hsm {
 
+// State stack: the active states from outermost (depth 0) to innermost, in a fixed-size array. Each depth has an
+// inline slot in which the StateMachine constructs the state pushed at that depth if it fits, so the states on the
+// stack are laid out contiguously and pushing them doesn't allocate. The stack also keeps, per state type, the
+// outermost depth at which that type is on the stack, so finding a state by type is a single table lookup.
+class StateStack
+{
+public:
+	typedef State** iterator;
+	typedef State* const* const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	static const size_t npos = ~static_cast<size_t>(0);
+
+	StateStack() : mSize(0) {}
+
+	iterator begin() { return mStates; }
+	iterator end() { return mStates + mSize; }
+	const_iterator begin() const { return mStates; }
+	const_iterator end() const { return mStates + mSize; }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	size_t size() const { return mSize; }
+	hsm_bool empty() const { return mSize == 0; }
+
+	State* operator[](size_t depth) const { HSM_ASSERT(depth < mSize); return mStates[depth]; }
+	State* back() const { HSM_ASSERT(mSize > 0); return mStates[mSize - 1]; }
+
+	void push_back(State* state)
+	{
+		HSM_ASSERT_MSG(mSize < HSM_MAX_STACK_DEPTH, "State stack overflow, increase HSM_MAX_STACK_DEPTH");
+
+		const size_t typeIndex = state->GetStateType().GetIndex();
+		if (typeIndex >= mTypeDepths.size())
+		{
+			// Sized for every state type known so far, so this only allocates when new state types appear
+			const size_t numStateTypes = GetNumStateTypes();
+			mTypeDepths.resize(numStateTypes > typeIndex ? numStateTypes : typeIndex + 1, 0);
+		}
+		if (mTypeDepths[typeIndex] == 0)
+		{
+			mTypeDepths[typeIndex] = static_cast<unsigned char>(mSize + 1);
+		}
+
+		mStates[mSize++] = state;
+	}
+
+	void pop_back()
+	{
+		HSM_ASSERT(mSize > 0);
+		// Inner states are popped first, so if this is the outermost instance of its type, it is the only one left
+		const size_t typeIndex = mStates[mSize - 1]->GetStateType().GetIndex();
+		if (mTypeDepths[typeIndex] == mSize)
+		{
+			mTypeDepths[typeIndex] = 0;
+		}
+		--mSize;
+	}
+
+	// Returns the depth of the outermost state of the input type, or npos if there is none on the stack
+	size_t FindOutermostDepth(StateTypeId stateType) const
+	{
+		const size_t typeIndex = stateType.GetIndex();
+		return typeIndex < mTypeDepths.size() && mTypeDepths[typeIndex] != 0 ? mTypeDepths[typeIndex] - 1u : npos;
+	}
+
+	// Returns the inline storage of the input depth, which fits states of up to HSM_STATE_SLOT_SIZE bytes
+	void* GetSlot(size_t depth) { HSM_ASSERT(depth < HSM_MAX_STACK_DEPTH); return &mSlots[depth]; }
+	static hsm_bool FitsInSlot(const StateFactory& stateFactory)
+	{
+		return stateFactory.GetStateSize() <= sizeof(SlotType) && stateFactory.GetStateAlignment() <= std::alignment_of<SlotType>::value;
+	}
+
+	hsm_bool IsInSlot(const State* state) const
+	{
+		const unsigned char* address = reinterpret_cast<const unsigned char*>(state);
+		const unsigned char* slots = reinterpret_cast<const unsigned char*>(mSlots);
+		return address >= slots && address < slots + sizeof(mSlots);
+	}
+
+private:
+	static_assert(HSM_MAX_STACK_DEPTH < 255, "Stack depths are stored in bytes");
+
+	// States hold pointers to themselves, so the stack can't be copied
+	StateStack(const StateStack&);
+	StateStack& operator=(const StateStack&);
+
+	typedef std::aligned_storage<HSM_STATE_SLOT_SIZE, std::alignment_of<std::max_align_t>::value>::type SlotType;
+
+	State* mStates[HSM_MAX_STACK_DEPTH];
+	size_t mSize;
+	HSM_STD_VECTOR<unsigned char> mTypeDepths; // Indexed by StateTypeId index: outermost depth + 1, or 0 if not on the stack
+	SlotType mSlots[HSM_MAX_STACK_DEPTH];
+};
+
 // State stack types
-typedef HSM_STD_VECTOR<State*> StackType;
+typedef StateStack StackType;
 typedef StackType::iterator OuterToInnerIterator;
 typedef StackType::reverse_iterator InnerToOuterIterator;
 
@@ -795,6 +1100,21 @@ namespace TraceLevel
 	};
 };
 
+// Describes a transition that was just made, passed to the transition callback
+struct TransitionEvent
+{
+	Transition::Type mTransitionType; // Sibling for the initial state
+	size_t mDepth; // Stack depth of the target state
+	StateTypeId mSourceStateType; // State that was replaced at mDepth; invalid if there was none
+	StateTypeId mTargetStateType;
+};
+
+typedef void (*TransitionCallback)(StateMachine& stateMachine, const TransitionEvent& event, void* userData);
+
+// Receives debug trace output, one line at a time without the trailing newline. May be called from any thread
+// that updates a state machine, so it must be thread-safe if state machines are updated in parallel.
+typedef void (*LogCallback)(const StateMachine& stateMachine, TraceLevel::Type level, const hsm_char* line, void* userData);
+
 // The main interface to the hierarchical state machine; a single state machine
 // manages a stack of states.
 class StateMachine
@@ -840,6 +1160,21 @@ public:
 	// Started means the state stack is not empty
 	hsm_bool IsStarted() { return !mStateStack.empty(); }
 
+	// States that fit in the state stack's inline slots (see HSM_STATE_SLOT_SIZE) never allocate. For larger states,
+	// when state pooling is enabled, the storage of popped states is kept in per-type free lists and reused
+	// by later transitions to the same state type, so once every state has been visited, transitions no longer
+	// allocate. Must be set while the state stack is empty. Pooled storage is released on Shutdown.
+	void SetStatePoolingEnabled(hsm_bool enabled);
+	hsm_bool IsStatePoolingEnabled() const { return mStatePoolingEnabled; }
+
+	// Pre-allocates pooled storage for count instances of StateType (requires state pooling). Does nothing for
+	// states that fit in the inline slots, as those are never pooled.
+	template <typename StateType>
+	void ReservePooledStates(size_t count);
+
+	// Frees all pooled storage not currently used by a state on the stack
+	void ReleasePooledStates();
+
 	// Debug tracing
 	void SetDebugInfo(const hsm_char* name, TraceLevel::Type traceLevel);
 	void SetDebugName(const hsm_char* name);
@@ -847,14 +1182,49 @@ public:
 	void SetDebugTraceLevel(TraceLevel::Type trace) { mDebugTraceLevel = trace; }
 	TraceLevel::Type GetDebugTraceLevel() const { return mDebugTraceLevel; }
 
+	// Sets where debug trace output goes; by default (or if callback is NULL) it is printed with HSM_PRINTF
+	void SetLogCallback(LogCallback callback, void* userData = 0) { mLogCallback = callback; mLogCallbackUserData = userData; }
+
+	// Sets a function invoked after each transition, once the target state's OnEnter has been called.
+	// Pass NULL to remove it.
+	void SetTransitionCallback(TransitionCallback callback, void* userData = 0) { mTransitionCallback = callback; mTransitionCallbackUserData = userData; }
+
 	// Call to update the state stack (usually once per frame). This function will iterate over the state stack,
 	// calling GetTransition() on each state, and will perform transitions until all states return NoTransition.
 	void ProcessStateTransitions();
 
+	// When enabled, ProcessStateTransitions only calls GetTransition() on states whose transition is dirty: states
+	// that called MarkTransitionDirty() since they were last asked, and every state at or outside the depth of a
+	// state that was pushed. If nothing is dirty, ProcessStateTransitions returns without walking the stack. Only
+	// use this if every state's GetTransition() result changes solely through code that marks it dirty.
+	// Must be set while the state stack is empty.
+	void SetDirtyTransitionsEnabled(hsm_bool enabled);
+	hsm_bool AreDirtyTransitionsEnabled() const { return mDirtyTransitionsEnabled; }
+
 	// Call after ProcessStateTransitions (once the state stack has settled) to allow each state to perform its
 	// work. Will invoke Update() on each state, from outermost to innermost.
 	void UpdateStates(HSM_STATE_UPDATE_ARGS);
 
+	// Event queue: instead of calling UpdateStates and ProcessStateTransitions as soon as an event occurs, events
+	// can be queued and dispatched together, usually once per frame. Returns false if the queue is full, in which
+	// case the event is dropped. The queue is a fixed-size ring buffer, so queuing never allocates.
+	hsm_bool QueueEvent(HSM_EVENT_TYPE event);
+
+	// Dispatches the events queued so far in the order they were queued: for each one, invokes UpdateStates with
+	// the event, then ProcessStateTransitions. Events queued by states during the dispatch are left for the next one.
+	// Each event gets its own UpdateStates, as it must reach the states made current by the previous events'
+	// transitions. With dirty transitions enabled, ProcessStateTransitions is skipped after the events that
+	// didn't mark a transition dirty; otherwise there is no telling without polling every state.
+	void DispatchQueuedEvents();
+
+	size_t GetNumQueuedEvents() const { return mNumQueuedEvents; }
+
+	// Queue statistics: the largest number of events queued at once, and the number of events dropped because
+	// the queue was full.
+	size_t GetEventQueueHighWaterMark() const { return mEventQueueHighWaterMark; }
+	size_t GetNumDroppedEvents() const { return mNumDroppedEvents; }
+	void ResetEventQueueStats() { mEventQueueHighWaterMark = mNumQueuedEvents; mNumDroppedEvents = 0; }
+
 	// Owner accessors (may return NULL)
 	Owner* GetOwner() { return mOwner; }
 	const Owner* GetOwner() const { return mOwner; }
@@ -867,7 +1237,7 @@ public:
 
 	// State stack query functions
 
-	// Returns NULL if state is not found on the stack
+	// Returns the outermost state of the input type, or NULL if there is none on the stack. Constant time, as is IsInState.
 	State* GetState(StateTypeId stateType);
 	const State* GetState(StateTypeId stateType) const { return const_cast<const State*>( const_cast<StateMachine*>(this)->GetState(stateType) ); }
 
@@ -912,8 +1282,16 @@ public:
 private:
 	friend struct State;
 
+	StateValueUndoLog& GetStateValueUndoLog() { return mStateValueUndoLog; }
+
 	void CreateAndPushInitialState(const Transition& transition);
 
+	State* CreateState(const Transition& transition, size_t stackDepth);
+	void DestroyState(State* state);
+
+	// Returns the free list for the input state type, creating it if necessary
+	HSM_STD_VECTOR<void*>& GetStatePoolFreeList(StateTypeId stateType);
+
 	// Returns state at input depth, or NULL if depth is invalid
 	State* GetStateAtDepth(size_t depth);
 
@@ -931,19 +1309,46 @@ private:
 	// Returns true if a transition was made, meaning we must keep processing
 	hsm_bool ProcessStateTransitionsOnce();
 
+	typedef unsigned long long DepthMask;
+	static_assert(HSM_MAX_STACK_DEPTH <= sizeof(DepthMask) * 8, "Dirty transition depths are stored in a DepthMask");
+
+	void MarkTransitionDirty(size_t depth) { mDirtyTransitionDepths |= DepthMask(1) << depth; }
+
 	void PushState(State* state);
 	void PopState();
 
+	void NotifyTransition(Transition::Type transitionType, size_t depth, StateTypeId sourceStateType, const State* targetState);
+
 	void Log(size_t minLevel, size_t numSpaces, const hsm_char* format, ...);
 	void LogTransition(size_t minLevel, size_t depth, const hsm_char* transType, State* state);
 
 	Owner* mOwner; // Provided by client, accessed within states via StateWithOwner<>::Owner()
 	Transition mInitialTransition;
 	StackType mStateStack;
+	StateValueUndoLog mStateValueUndoLog;
 
 	typedef std::map<const StateFactory*, const StateFactory*> OverrideMap;
 	OverrideMap mStateOverrides;
 
+	typedef HSM_STD_VECTOR< HSM_STD_VECTOR<void*> > StatePool; // Free lists indexed by StateTypeId index
+	StatePool mStatePool;
+	hsm_bool mStatePoolingEnabled;
+
+	hsm_bool mDirtyTransitionsEnabled;
+	DepthMask mDirtyTransitionDepths; // Bit per stack depth whose state must be asked for its transition
+
+	HSM_EVENT_TYPE mEventQueue[HSM_EVENT_QUEUE_CAPACITY];
+	size_t mEventQueueHead; // Index of the oldest queued event
+	size_t mNumQueuedEvents;
+	size_t mEventQueueHighWaterMark;
+	size_t mNumDroppedEvents;
+
+	TransitionCallback mTransitionCallback;
+	void* mTransitionCallbackUserData;
+
+	LogCallback mLogCallback;
+	void* mLogCallbackUserData;
+
 	hsm_char mDebugName[HSM_DEBUG_NAME_MAXLEN];
 	TraceLevel::Type mDebugTraceLevel;
 };
@@ -951,6 +1356,29 @@ private:
 
 // Inline State member function implementations - implemented here because they depend StateMachine being defined
 
+template <typename T>
+T& State::SetStateValue(StateValue<T>& stateValue)
+{
+	GetStateMachine().GetStateValueUndoLog().Save(mStackDepth, stateValue);
+
+	// Return its value so it can be modified
+	return stateValue.mValue;
+}
+
+inline void State::ResetStateValues()
+{
+	// States that were never pushed have nothing to restore
+	if (mOwnerStateMachine)
+	{
+		mOwnerStateMachine->GetStateValueUndoLog().RestoreDepth(mStackDepth);
+	}
+}
+
+inline void State::MarkTransitionDirty()
+{
+	GetStateMachine().MarkTransitionDirty(mStackDepth);
+}
+
 template <typename StateType>
 StateType* State::GetState()
 {
@@ -1036,6 +1464,22 @@ inline void StateMachine::RemoveStateOverride()
 	mStateOverrides.erase(mStateOverrides.find(&sourceStateFactory));
 }
 
+template <typename StateType>
+inline void StateMachine::ReservePooledStates(size_t count)
+{
+	HSM_ASSERT_MSG(mStatePoolingEnabled, "ReservePooledStates requires state pooling");
+	const StateFactory& stateFactory = GetStateFactory<StateType>();
+	if (StackType::FitsInSlot(stateFactory))
+		return;
+
+	HSM_STD_VECTOR<void*>& freeList = GetStatePoolFreeList(stateFactory.GetStateType());
+	freeList.reserve(freeList.size() + count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		freeList.push_back(HSM_ALLOC_STORAGE(stateFactory.GetStateSize()));
+	}
+}
+
 template <typename SourceState>
 inline const StateFactory& StateMachine::GetStateOverride()
 {
@@ -1060,22 +1504,11 @@ namespace detail
 		state->mOwnerStateMachine = ownerStateMachine;
 		state->mOwner = ownerStateMachine->GetOwner();
 		state->mStackDepth = stackDepth;
+		state->mStateFactory = &stateFactory;
 		state->mStateTypeId = stateFactory.GetStateType();
 		state->mStateDebugName = stateFactory.GetStateName();
 	}
 
-	inline State* CreateState(const Transition& transition, StateMachine* ownerStateMachine, size_t stackDepth)
-	{
-		State* state = transition.GetStateFactory().AllocateState();
-		InitState(state, ownerStateMachine, stackDepth, transition.GetStateFactory());
-		return state;
-	}
-
-	inline void DestroyState(State* state)
-	{
-		HSM_DELETE(state);
-	}
-
 	inline void InvokeStateOnEnter(const Transition& transition, State* state)
 	{
 		if (const auto& onEnterArgsFunc = transition.GetOnEnterArgsFunc())
@@ -1096,6 +1529,17 @@ namespace detail
 
 inline StateMachine::StateMachine()
 	: mOwner(0)
+	, mStatePoolingEnabled(hsm_false)
+	, mDirtyTransitionsEnabled(hsm_false)
+	, mDirtyTransitionDepths(0)
+	, mEventQueueHead(0)
+	, mNumQueuedEvents(0)
+	, mEventQueueHighWaterMark(0)
+	, mNumDroppedEvents(0)
+	, mTransitionCallback(0)
+	, mTransitionCallbackUserData(0)
+	, mLogCallback(0)
+	, mLogCallbackUserData(0)
 	, mDebugTraceLevel(TraceLevel::None)
 {
 	mDebugName[0] = '\0';
@@ -1113,6 +1557,10 @@ inline void StateMachine::Shutdown(hsm_bool stop)
 
 	// Free any allocated states
 	PopStatesToDepth(0, hsm_false);
+	ReleasePooledStates();
+
+	mEventQueueHead = 0;
+	mNumQueuedEvents = 0;
 
 	mOwner = 0;
 	mInitialTransition = NoTransition();
@@ -1124,6 +1572,98 @@ inline void StateMachine::Stop()
 	HSM_ASSERT(mStateStack.empty());
 }
 
+inline void StateMachine::SetStatePoolingEnabled(hsm_bool enabled)
+{
+	HSM_ASSERT_MSG(mStateStack.empty(), "State pooling can only be changed while the state stack is empty");
+	if (!enabled)
+	{
+		ReleasePooledStates();
+	}
+	mStatePoolingEnabled = enabled;
+}
+
+inline void StateMachine::SetDirtyTransitionsEnabled(hsm_bool enabled)
+{
+	HSM_ASSERT_MSG(mStateStack.empty(), "Dirty transitions can only be changed while the state stack is empty");
+	mDirtyTransitionsEnabled = enabled;
+}
+
+inline void StateMachine::ReleasePooledStates()
+{
+	for (size_t i = 0; i < mStatePool.size(); ++i)
+	{
+		HSM_STD_VECTOR<void*>& freeList = mStatePool[i];
+		for (size_t j = 0; j < freeList.size(); ++j)
+		{
+			HSM_FREE_STORAGE(freeList[j]);
+		}
+	}
+	mStatePool.clear();
+}
+
+inline HSM_STD_VECTOR<void*>& StateMachine::GetStatePoolFreeList(StateTypeId stateType)
+{
+	const size_t index = stateType.GetIndex();
+	if (index >= mStatePool.size())
+	{
+		mStatePool.resize(index + 1);
+	}
+	return mStatePool[index];
+}
+
+inline State* StateMachine::CreateState(const Transition& transition, size_t stackDepth)
+{
+	const StateFactory& stateFactory = transition.GetStateFactory();
+	State* state = 0;
+
+	if (StackType::FitsInSlot(stateFactory))
+	{
+		state = stateFactory.ConstructState(mStateStack.GetSlot(stackDepth));
+	}
+	else if (mStatePoolingEnabled)
+	{
+		HSM_STD_VECTOR<void*>& freeList = GetStatePoolFreeList(stateFactory.GetStateType());
+		void* storage = 0;
+		if (freeList.empty())
+		{
+			// Grow the free list now so that returning this storage to it later doesn't allocate
+			freeList.reserve(freeList.size() + 1);
+			storage = HSM_ALLOC_STORAGE(stateFactory.GetStateSize());
+		}
+		else
+		{
+			storage = freeList.back();
+			freeList.pop_back();
+		}
+		state = stateFactory.ConstructState(storage);
+	}
+	else
+	{
+		state = stateFactory.AllocateState();
+	}
+
+	detail::InitState(state, this, stackDepth, stateFactory);
+	return state;
+}
+
+inline void StateMachine::DestroyState(State* state)
+{
+	if (mStateStack.IsInSlot(state))
+	{
+		state->mStateFactory->DestructState(state);
+	}
+	else if (mStatePoolingEnabled)
+	{
+		const StateFactory& stateFactory = *state->mStateFactory;
+		HSM_STD_VECTOR<void*>& freeList = GetStatePoolFreeList(state->mStateTypeId);
+		freeList.push_back(stateFactory.DestructState(state));
+	}
+	else
+	{
+		HSM_DELETE(state);
+	}
+}
+
 inline void StateMachine::SetDebugInfo(const hsm_char* name, TraceLevel::Type traceLevel)
 {
 	SetDebugName(name);
@@ -1138,6 +1678,8 @@ inline void StateMachine::SetDebugName(const hsm_char* name)
 
 inline void StateMachine::ProcessStateTransitions()
 {
+	HSM_PROFILE_SCOPE(ProcessStateTransitions);
+
 	// If the state stack is empty, push the initial state
 	if (mStateStack.empty())
 	{
@@ -1162,6 +1704,8 @@ inline void StateMachine::ProcessStateTransitions()
 
 inline void StateMachine::UpdateStates(HSM_STATE_UPDATE_ARGS)
 {
+	HSM_PROFILE_SCOPE(UpdateStates);
+
 	OuterToInnerIterator iter = BeginOuterToInner();
 	OuterToInnerIterator end = EndOuterToInner();
 	for ( ; iter != end; ++iter)
@@ -1170,15 +1714,45 @@ inline void StateMachine::UpdateStates(HSM_STATE_UPDATE_ARGS)
 	}
 }
 
-inline State* StateMachine::GetState(StateTypeId stateType)
+inline hsm_bool StateMachine::QueueEvent(HSM_EVENT_TYPE event)
 {
-	for (size_t i = 0; i < mStateStack.size(); ++i)
+	if (mNumQueuedEvents == HSM_EVENT_QUEUE_CAPACITY)
 	{
-		State* state = mStateStack[i];
-		if (state->GetStateType() == stateType)
-			return state;
+		++mNumDroppedEvents;
+		return hsm_false;
 	}
-	return 0;
+
+	mEventQueue[(mEventQueueHead + mNumQueuedEvents) % HSM_EVENT_QUEUE_CAPACITY] = event;
+	++mNumQueuedEvents;
+
+	if (mNumQueuedEvents > mEventQueueHighWaterMark)
+	{
+		mEventQueueHighWaterMark = mNumQueuedEvents;
+	}
+	return hsm_true;
+}
+
+inline void StateMachine::DispatchQueuedEvents()
+{
+	const size_t numEventsToDispatch = mNumQueuedEvents;
+	for (size_t i = 0; i < numEventsToDispatch; ++i)
+	{
+		const HSM_EVENT_TYPE event = mEventQueue[mEventQueueHead];
+		mEventQueueHead = (mEventQueueHead + 1) % HSM_EVENT_QUEUE_CAPACITY;
+		--mNumQueuedEvents;
+
+		UpdateStates(event);
+		if (!mDirtyTransitionsEnabled || mDirtyTransitionDepths != 0 || mStateStack.empty())
+		{
+			ProcessStateTransitions();
+		}
+	}
+}
+
+inline State* StateMachine::GetState(StateTypeId stateType)
+{
+	const size_t depth = mStateStack.FindOutermostDepth(stateType);
+	return depth != StackType::npos ? mStateStack[depth] : 0;
 }
 
 inline State* StateMachine::GetStateAtDepth(size_t depth)
@@ -1199,6 +1773,11 @@ inline State* StateMachine::GetStateAtDepth(size_t depth, StateTypeId stateType)
 
 inline State* StateMachine::GetOuterState(StateTypeId stateType, size_t startDepth)
 {
+	// No instance at or above startDepth; otherwise search for the nearest one, as the type may be on the stack more than once
+	const size_t outermostDepth = mStateStack.FindOutermostDepth(stateType);
+	if (outermostDepth == StackType::npos || outermostDepth > startDepth)
+		return 0;
+
 	const size_t numStatesToCompare = startDepth + 1;
 	size_t currDepth = startDepth;
 
@@ -1218,6 +1797,12 @@ inline const State* StateMachine::GetOuterState(StateTypeId stateType, size_t st
 
 inline State* StateMachine::GetInnerState(StateTypeId stateType, size_t startDepth)
 {
+	const size_t outermostDepth = mStateStack.FindOutermostDepth(stateType);
+	if (outermostDepth == StackType::npos)
+		return 0;
+	if (outermostDepth >= startDepth)
+		return mStateStack[outermostDepth];
+
 	for (size_t i = startDepth; i < mStateStack.size(); ++i)
 	{
 		State* state = mStateStack[i];
@@ -1235,10 +1820,11 @@ inline const State* StateMachine::GetInnerState(StateTypeId stateType, size_t st
 inline void StateMachine::CreateAndPushInitialState(const Transition& transition)
 {
 	HSM_ASSERT(mStateStack.empty());
-	State* initialState = detail::CreateState(transition, this, 0);
+	State* initialState = CreateState(transition, 0);
 	HSM_LOG_TRANSITION(1, 0, HSM_TEXT("Init"), initialState);
 	PushState(initialState);
 	detail::InvokeStateOnEnter(transition, initialState);
+	NotifyTransition(Transition::Sibling, 0, StateTypeId(), initialState);
 }
 
 inline void StateMachine::PopStatesToDepth(size_t depth, hsm_bool invokeOnExit)
@@ -1249,7 +1835,7 @@ inline void StateMachine::PopStatesToDepth(size_t depth, hsm_bool invokeOnExit)
 	for (size_t i = 0; i < numStatesToPop; ++i, --currDepth)
 	{
 		State* state = mStateStack.back();
-		HSM_ASSERT(state == mStateStack.at(currDepth));
+		HSM_ASSERT(state == mStateStack[currDepth]);
 
 		if (invokeOnExit)
 		{
@@ -1257,7 +1843,7 @@ inline void StateMachine::PopStatesToDepth(size_t depth, hsm_bool invokeOnExit)
 			detail::InvokeStateOnExit(state);
 		}
 		PopState();
-		detail::DestroyState(state);
+		DestroyState(state);
 	}
 }
 
@@ -1267,9 +1853,23 @@ inline hsm_bool StateMachine::ProcessStateTransitionsOnce()
 	// is returned, we must pop inners up to and including the state that returned the transition,
 	// then push the new inner. If an inner transition is returned, we must pop inners up to but
 	// not including the state that returned the transition (if any), then push the new inner.
+	// With dirty transitions enabled, only the states at dirty depths are asked for their transition.
+
+	if (mDirtyTransitionsEnabled && mDirtyTransitionDepths == 0)
+		return hsm_false;
 
 	for (size_t depth = 0; depth < mStateStack.size(); ++depth)
 	{
+		if (mDirtyTransitionsEnabled)
+		{
+			const DepthMask depthBit = DepthMask(1) << depth;
+			if ((mDirtyTransitionDepths & depthBit) == 0)
+				continue;
+
+			// Cleared before asking, so the state can mark itself dirty again from GetTransition
+			mDirtyTransitionDepths &= ~depthBit;
+		}
+
 		State* currState = GetStateAtDepth(depth);
 		const Transition& transition = currState->GetTransition();
 
@@ -1294,22 +1894,25 @@ inline hsm_bool StateMachine::ProcessStateTransitionsOnce()
 					else
 					{
 						// Pop all states under us and push target
+						const StateTypeId sourceStateType = innerState->GetStateType();
 						PopStatesToDepth(depth + 1);
 
-						State* targetState = detail::CreateState(transition, this, depth + 1);
+						State* targetState = CreateState(transition, depth + 1);
 						HSM_LOG_TRANSITION(1, depth + 1, HSM_TEXT("Inner"), targetState);
 						PushState(targetState);
 						detail::InvokeStateOnEnter(transition, targetState);
+						NotifyTransition(Transition::Inner, depth + 1, sourceStateType, targetState);
 						return hsm_true;
 					}
 				}
 				else
 				{
 					// No state under us so just push target
-					State* targetState = detail::CreateState(transition, this, depth + 1);
+					State* targetState = CreateState(transition, depth + 1);
 					HSM_LOG_TRANSITION(1, depth + 1, HSM_TEXT("Inner"), targetState);
 					PushState(targetState);
 					detail::InvokeStateOnEnter(transition, targetState);
+					NotifyTransition(Transition::Inner, depth + 1, StateTypeId(), targetState);
 					return hsm_true;
 				}
 			}
@@ -1320,10 +1923,11 @@ inline hsm_bool StateMachine::ProcessStateTransitionsOnce()
 				// If current state has no inner (is currently the innermost), then push the entry state
 				if ( !GetStateAtDepth(depth + 1) )
 				{
-					State* targetState = detail::CreateState(transition, this, depth + 1);
+					State* targetState = CreateState(transition, depth + 1);
 					HSM_LOG_TRANSITION(1, depth + 1, HSM_TEXT("Entry"), targetState);
 					PushState(targetState);
 					detail::InvokeStateOnEnter(transition, targetState);
+					NotifyTransition(Transition::InnerEntry, depth + 1, StateTypeId(), targetState);
 					return hsm_true;
 				}
 			}
@@ -1331,12 +1935,14 @@ inline hsm_bool StateMachine::ProcessStateTransitionsOnce()
 
 			case Transition::Sibling:
 			{
+				const StateTypeId sourceStateType = currState->GetStateType();
 				PopStatesToDepth(depth);
 
-				State* targetState = detail::CreateState(transition, this, depth);
+				State* targetState = CreateState(transition, depth);
 				HSM_LOG_TRANSITION(1, depth, HSM_TEXT("Sibling"), targetState);
 				PushState(targetState);
 				detail::InvokeStateOnEnter(transition, targetState);
+				NotifyTransition(Transition::Sibling, depth, sourceStateType, targetState);
 				return hsm_true;
 			}
 			break;
@@ -1349,28 +1955,64 @@ inline hsm_bool StateMachine::ProcessStateTransitionsOnce()
 
 inline void StateMachine::PushState(State* state)
 {
+	// The new state must be asked for its transition, and so must its outers, as they may transition their inners
+	mDirtyTransitionDepths |= (DepthMask(2) << mStateStack.size()) - 1;
 	mStateStack.push_back(state);
 }
 
 inline void StateMachine::PopState()
 {
 	mStateStack.pop_back();
+	mDirtyTransitionDepths &= ~(DepthMask(1) << mStateStack.size());
+}
+
+inline void StateMachine::NotifyTransition(Transition::Type transitionType, size_t depth, StateTypeId sourceStateType, const State* targetState)
+{
+	if (mTransitionCallback)
+	{
+		TransitionEvent event;
+		event.mTransitionType = transitionType;
+		event.mDepth = depth;
+		event.mSourceStateType = sourceStateType;
+		event.mTargetStateType = targetState->GetStateType();
+		mTransitionCallback(*this, event, mTransitionCallbackUserData);
+	}
 }
 
 inline void StateMachine::Log(size_t minLevel, size_t numSpaces, const hsm_char* format, ...)
 {
 	if (static_cast<size_t>(mDebugTraceLevel) >= minLevel)
 	{
-		static hsm_char buffer[4096];
- 		int offset = SNPRINTF(buffer, sizeof(buffer), HSM_TEXT("HSM_%lu_%s:%*s "), static_cast<unsigned long>(minLevel), mDebugName, static_cast<int>(numSpaces), "");
+		// Format on the stack so that machines can log concurrently from different threads
+		hsm_char buffer[HSM_LOG_LINE_MAXLEN];
+		const size_t bufferLen = sizeof(buffer) / sizeof(buffer[0]);
+		int offset = SNPRINTF(buffer, bufferLen, HSM_TEXT("HSM_%lu_%s:%*s "), static_cast<unsigned long>(minLevel), mDebugName, static_cast<int>(numSpaces), "");
+		if (offset < 0)
+			return;
+		if (static_cast<size_t>(offset) >= bufferLen)
+			offset = static_cast<int>(bufferLen - 1);
 
 		va_list args;
 		va_start(args, format);
-		VSNPRINTF(buffer + offset, sizeof(buffer) - offset - 1, format, args);
-
-		// Print to stdout
-		HSM_PRINTF(HSM_TEXT("%s"), buffer);
+		int length = VSNPRINTF(buffer + offset, bufferLen - offset, format, args);
 		va_end(args);
+
+		// Strip the trailing newline; sinks deal in lines
+		size_t end = length < 0 ? offset : offset + static_cast<size_t>(length);
+		if (end >= bufferLen)
+			end = bufferLen - 1;
+		if (end > 0 && buffer[end - 1] == HSM_TEXT('\n'))
+			--end;
+		buffer[end] = HSM_TEXT('\0');
+
+		if (mLogCallback)
+		{
+			mLogCallback(*this, static_cast<TraceLevel::Type>(minLevel), buffer, mLogCallbackUserData);
+		}
+		else
+		{
+			HSM_PRINTF(HSM_TEXT("%s\n"), buffer);
+		}
 	}
 }
 
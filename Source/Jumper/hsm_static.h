@@ -0,0 +1,391 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/// \file hsm_static.h
+/// \brief Compile-time state machine for flat state sets, alongside hsm::StateMachine
+
+// StaticStateMachine is an alternative to hsm::StateMachine for machines whose states are all known at compile
+// time and are siblings (no inner states). The states are listed in a StaticStateList, the current state lives
+// in a union sized for the largest one, and every call into a state is dispatched on the current state's index
+// through a chain of compile-time type tests that the optimizer turns into a switch. State functions aren't
+// virtual, so the compiler can inline them.
+//
+// States derive from StaticState<OwnerType, StateListType> instead of StateWithOwner<OwnerType>, which provides
+// Owner(), SiblingTransition<TargetState>() and NoTransition() with the same spelling as in hsm.h, and a nested
+// Transition type, so ported states only change their base class:
+//
+//	struct IdleState;
+//	struct JumpingState;
+//	typedef hsm::StaticStateList<IdleState, JumpingState> MyStates;
+//
+//	struct IdleState : hsm::StaticState<MyOwner, MyStates>
+//	{
+//		Transition GetTransition() { return Owner().bJumped ? SiblingTransition<JumpingState>() : NoTransition(); }
+//	};
+//
+//	hsm::StaticStateMachine<MyOwner, MyStates> StateMachine;
+//	StateMachine.Initialize<IdleState>(&Owner);
+//
+// Not supported compared to hsm::StateMachine: inner states, OnEnter args, StateValues, state overrides, pooling
+// (there is nothing to allocate), transition and log callbacks, and debug tracing.
+
+#pragma once
+
+#include "hsm.h"
+
+#include <new>
+#include <type_traits>
+
+namespace hsm {
+
+// Type list of the states of a StaticStateMachine. Only compares types, so the states may still be incomplete.
+template <typename... States>
+struct StaticStateList
+{
+	static const int NumStates = static_cast<int>(sizeof...(States));
+
+	// Index of StateType in the list; a compile-time error if it isn't in it
+	template <typename StateType>
+	static constexpr int IndexOf()
+	{
+		static_assert(Find<StateType, States...>::Index >= 0, "State is not in the StaticStateList");
+		return Find<StateType, States...>::Index;
+	}
+
+	template <typename StateType>
+	static constexpr hsm_bool Contains() { return Find<StateType, States...>::Index >= 0; }
+
+private:
+	template <typename StateType, typename... Rest>
+	struct Find
+	{
+		static const int Index = -1;
+	};
+
+	template <typename StateType, typename First, typename... Rest>
+	struct Find<StateType, First, Rest...>
+	{
+		static const int Index = std::is_same<StateType, First>::value ? 0
+			: (Find<StateType, Rest...>::Index < 0 ? -1 : Find<StateType, Rest...>::Index + 1);
+	};
+};
+
+// Sibling transition to a state of the list, by index; returned by StaticState::SiblingTransition
+struct StaticTransition
+{
+	StaticTransition() : mTargetIndex(-1) {}
+	explicit StaticTransition(int targetIndex) : mTargetIndex(targetIndex) {}
+
+	hsm_bool IsNo() const { return mTargetIndex < 0; }
+	int GetTargetIndex() const { return mTargetIndex; }
+
+	int mTargetIndex;
+};
+
+template <typename OwnerType, typename StateListType>
+class StaticStateMachine;
+
+// Base of the states of a StaticStateMachine. Derived states hide these functions rather than override them.
+template <typename OwnerType, typename StateListType>
+struct StaticState
+{
+	typedef StaticTransition Transition;
+
+	StaticState() : mOwner(0) {}
+
+	const OwnerType& Owner() const
+	{
+		HSM_ASSERT(mOwner);
+		return *mOwner;
+	}
+
+	OwnerType& Owner()
+	{
+		HSM_ASSERT(mOwner);
+		return *mOwner;
+	}
+
+	template <typename TargetState>
+	static StaticTransition SiblingTransition() { return StaticTransition(StateListType::template IndexOf<TargetState>()); }
+
+	static StaticTransition NoTransition() { return StaticTransition(); }
+
+	void OnEnter() {}
+	void OnExit() {}
+	StaticTransition GetTransition() { return NoTransition(); }
+	void Update(HSM_STATE_UPDATE_ARGS) {}
+
+private:
+	friend class StaticStateMachine<OwnerType, StateListType>;
+	OwnerType* mOwner;
+};
+
+namespace detail
+{
+	// Calls func with the state at index as its static type, testing the indices in order
+	template <int Index, typename... States>
+	struct StaticStateVisitor
+	{
+		template <typename Func>
+		static void Visit(int, void*, Func&) { HSM_ASSERT_MSG(hsm_false, "Invalid state index"); }
+	};
+
+	template <int Index, typename First, typename... Rest>
+	struct StaticStateVisitor<Index, First, Rest...>
+	{
+		template <typename Func>
+		static void Visit(int stateIndex, void* storage, Func& func)
+		{
+			if (stateIndex == Index)
+			{
+				func(*static_cast<First*>(storage));
+			}
+			else
+			{
+				StaticStateVisitor<Index + 1, Rest...>::Visit(stateIndex, storage, func);
+			}
+		}
+	};
+
+	template <typename StateListType>
+	struct StaticStateListTraits;
+
+	template <typename... States>
+	struct StaticStateListTraits< StaticStateList<States...> >
+	{
+		typedef typename std::aligned_union<0, States...>::type StorageType;
+
+		template <typename Func>
+		static void Visit(int stateIndex, void* storage, Func& func)
+		{
+			StaticStateVisitor<0, States...>::Visit(stateIndex, storage, func);
+		}
+
+		// Constructs the state at index in storage
+		template <int Index, typename... Rest>
+		struct Constructor
+		{
+			static void Construct(int, void*) { HSM_ASSERT_MSG(hsm_false, "Invalid state index"); }
+		};
+
+		template <int Index, typename First, typename... Rest>
+		struct Constructor<Index, First, Rest...>
+		{
+			static void Construct(int stateIndex, void* storage)
+			{
+				if (stateIndex == Index)
+				{
+					::new (storage) First();
+				}
+				else
+				{
+					Constructor<Index + 1, Rest...>::Construct(stateIndex, storage);
+				}
+			}
+		};
+
+		static void Construct(int stateIndex, void* storage)
+		{
+			Constructor<0, States...>::Construct(stateIndex, storage);
+		}
+	};
+}
+
+template <typename OwnerType, typename StateListType>
+class StaticStateMachine
+{
+public:
+	typedef StaticState<OwnerType, StateListType> StateBaseType;
+
+	StaticStateMachine()
+		: mOwner(0)
+		, mInitialStateIndex(-1)
+		, mStateIndex(-1)
+		, mEventQueueHead(0)
+		, mNumQueuedEvents(0)
+		, mEventQueueHighWaterMark(0)
+		, mNumDroppedEvents(0)
+	{
+	}
+
+	~StaticStateMachine() { Shutdown(hsm_false); }
+
+	template <typename InitialStateType>
+	void Initialize(OwnerType* owner = 0)
+	{
+		HSM_ASSERT(mInitialStateIndex < 0);
+		mInitialStateIndex = StateListType::template IndexOf<InitialStateType>();
+		mOwner = owner;
+	}
+
+	// Shuts down the state machine, after which Initialize() must be called to use it again. If stop is true,
+	// invokes Stop(); otherwise the current state is destroyed without OnExit.
+	void Shutdown(hsm_bool stop = hsm_true)
+	{
+		if (stop)
+			Stop();
+		DestroyState();
+
+		mEventQueueHead = 0;
+		mNumQueuedEvents = 0;
+		mOwner = 0;
+		mInitialStateIndex = -1;
+	}
+
+	hsm_bool IsInitialized() const { return mInitialStateIndex >= 0; }
+
+	// Exits the current state; a subsequent call to ProcessStateTransitions enters the initial state again
+	void Stop()
+	{
+		if (IsStarted())
+		{
+			VisitState([](auto& state) { state.OnExit(); });
+			DestroyState();
+		}
+	}
+
+	hsm_bool IsStarted() const { return mStateIndex >= 0; }
+
+	// Enters the initial state if not started, then makes transitions until the current state returns NoTransition
+	void ProcessStateTransitions()
+	{
+		HSM_PROFILE_SCOPE(ProcessStaticStateTransitions);
+
+		if (!IsStarted())
+		{
+			HSM_ASSERT_MSG(IsInitialized(), "Must call Initialize()");
+			EnterState(mInitialStateIndex);
+		}
+
+		for (int numTransitionsProcessed = 0; ; ++numTransitionsProcessed)
+		{
+			HSM_ASSERT_MSG(numTransitionsProcessed < 1000, "ProcessStateTransitions: detected infinite transition loop");
+
+			StaticTransition transition;
+			VisitState([&transition](auto& state) { transition = state.GetTransition(); });
+			if (transition.IsNo())
+				break;
+
+			VisitState([](auto& state) { state.OnExit(); });
+			DestroyState();
+			EnterState(transition.GetTargetIndex());
+		}
+	}
+
+	void UpdateStates(HSM_STATE_UPDATE_ARGS)
+	{
+		HSM_PROFILE_SCOPE(UpdateStaticStates);
+
+		if (IsStarted())
+		{
+			VisitState([&](auto& state) { state.Update(HSM_STATE_UPDATE_ARGS_FORWARD); });
+		}
+	}
+
+	// Event queue and its statistics; same behavior as hsm::StateMachine's
+	hsm_bool QueueEvent(HSM_EVENT_TYPE event)
+	{
+		if (mNumQueuedEvents == HSM_EVENT_QUEUE_CAPACITY)
+		{
+			++mNumDroppedEvents;
+			return hsm_false;
+		}
+
+		mEventQueue[(mEventQueueHead + mNumQueuedEvents) % HSM_EVENT_QUEUE_CAPACITY] = event;
+		++mNumQueuedEvents;
+
+		if (mNumQueuedEvents > mEventQueueHighWaterMark)
+			mEventQueueHighWaterMark = mNumQueuedEvents;
+		return hsm_true;
+	}
+
+	void DispatchQueuedEvents()
+	{
+		const size_t numEventsToDispatch = mNumQueuedEvents;
+		for (size_t i = 0; i < numEventsToDispatch; ++i)
+		{
+			const HSM_EVENT_TYPE event = mEventQueue[mEventQueueHead];
+			mEventQueueHead = (mEventQueueHead + 1) % HSM_EVENT_QUEUE_CAPACITY;
+			--mNumQueuedEvents;
+
+			UpdateStates(event);
+			ProcessStateTransitions();
+		}
+	}
+
+	size_t GetNumQueuedEvents() const { return mNumQueuedEvents; }
+
+	size_t GetEventQueueHighWaterMark() const { return mEventQueueHighWaterMark; }
+	size_t GetNumDroppedEvents() const { return mNumDroppedEvents; }
+	void ResetEventQueueStats() { mEventQueueHighWaterMark = mNumQueuedEvents; mNumDroppedEvents = 0; }
+
+	OwnerType* GetOwner() { return mOwner; }
+	const OwnerType* GetOwner() const { return mOwner; }
+
+	// Index of the current state in the state list, or -1 if not started
+	int GetStateIndex() const { return mStateIndex; }
+
+	template <typename StateType>
+	hsm_bool IsInState() const { return mStateIndex == StateListType::template IndexOf<StateType>(); }
+
+	// Returns the current state if it is a StateType, NULL otherwise
+	template <typename StateType>
+	StateType* GetState() { return IsInState<StateType>() ? reinterpret_cast<StateType*>(&mStorage) : 0; }
+
+	template <typename StateType>
+	const StateType* GetState() const { return IsInState<StateType>() ? reinterpret_cast<const StateType*>(&mStorage) : 0; }
+
+	// Calls func(state) with the current state as its most-derived type; func must accept every state of the list,
+	// e.g. a generic lambda. This is how the machine itself calls into states, so their functions are resolved statically.
+	template <typename Func>
+	void VisitState(Func&& func)
+	{
+		HSM_ASSERT(IsStarted());
+		detail::StaticStateListTraits<StateListType>::Visit(mStateIndex, &mStorage, func);
+	}
+
+private:
+	typedef typename detail::StaticStateListTraits<StateListType>::StorageType StorageType;
+
+	// Non-copyable, as the current state lives inside the machine
+	StaticStateMachine(const StaticStateMachine&);
+	StaticStateMachine& operator=(const StaticStateMachine&);
+
+	void EnterState(int stateIndex)
+	{
+		detail::StaticStateListTraits<StateListType>::Construct(stateIndex, &mStorage);
+		mStateIndex = stateIndex;
+
+		OwnerType* owner = mOwner;
+		VisitState([owner](auto& state)
+		{
+			static_cast<StateBaseType&>(state).mOwner = owner;
+			state.OnEnter();
+		});
+	}
+
+	void DestroyState()
+	{
+		if (IsStarted())
+		{
+			VisitState([](auto& state)
+			{
+				typedef typename std::decay<decltype(state)>::type StateType;
+				state.~StateType();
+			});
+			mStateIndex = -1;
+		}
+	}
+
+	OwnerType* mOwner;
+	int mInitialStateIndex;
+	int mStateIndex;
+	StorageType mStorage;
+
+	HSM_EVENT_TYPE mEventQueue[HSM_EVENT_QUEUE_CAPACITY];
+	size_t mEventQueueHead;
+	size_t mNumQueuedEvents;
+	size_t mEventQueueHighWaterMark;
+	size_t mNumDroppedEvents;
+};
+
+} // namespace hsm